@@ -0,0 +1,261 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "rgb_keyboard.h"
+#include "static_table.h"
+
+namespace {
+    using rgb_keyboard::animation;
+    using rgb_keyboard::max_keys;
+
+    // the helpers below avoid library calls so that the kernel loops can be vectorized
+
+    // floor for values that fit into an int, the sign bit of the remainder replaces a comparison
+    inline float floor_fast(float v) {
+        int truncated = static_cast<int>(v);
+        float difference = v - static_cast<float>(truncated);
+        uint32_t bits;
+        std::memcpy(&bits, &difference, sizeof(bits));
+        return static_cast<float>(truncated - static_cast<int>(bits >> 31));
+    }
+
+    inline float fract(float v) {
+        return v - floor_fast(v);
+    }
+
+    inline float clamp01(float v) {
+        return std::fmin(std::fmax(v, 0.0f), 1.0f);
+    }
+
+    // sine approximation, absolute error < 0.001
+    inline float sin_fast(float x) {
+        float t = x * 0.15915494f;      // x / 2π
+        t -= floor_fast(t + 0.5f);      // -0.5 to 0.5
+        float z = 2.0f * t;             // sin(π z)
+        float y = 4.0f * z * (1.0f - std::abs(z));
+        return 0.225f * (y * std::abs(y) - y) + y;
+    }
+
+    // pseudo random value 0-1 of a lattice point
+    inline float lattice(int x, int y) {
+        uint32_t h = static_cast<uint32_t>(x) * 374761393u + static_cast<uint32_t>(y) * 668265263u;
+        h = (h ^ (h >> 13)) * 1274126177u;
+        h ^= h >> 16;
+        return (h & 0xffff) * (1.0f / 65535.0f);
+    }
+
+    // smooth value noise 0-1
+    inline float noise(float x, float y) {
+        float ix = floor_fast(x), iy = floor_fast(y);
+        float fx = x - ix, fy = y - iy;
+        fx = fx * fx * (3.0f - 2.0f * fx);
+        fy = fy * fy * (3.0f - 2.0f * fy);
+        int x0 = static_cast<int>(ix), y0 = static_cast<int>(iy);
+        float top = lattice(x0, y0) + fx * (lattice(x0 + 1, y0) - lattice(x0, y0));
+        float bottom = lattice(x0, y0 + 1) + fx * (lattice(x0 + 1, y0 + 1) - lattice(x0, y0 + 1));
+        return top + fy * (bottom - top);
+    }
+
+    // effect kernels, the fields are sampled at the key centers
+
+    // palette scrolling from right to left
+    void gradient(const animation::effect_input& input, float* value) {
+        const float scale = 1.0f / input.geometry.width;
+        const float offset = input.time * 0.2f;
+        input.geometry.rasterize([=](float x, float) { return fract(x * scale + offset); }, value);
+    }
+
+    // diagonal sine wave
+    void wave(const animation::effect_input& input, float* value) {
+        const float phase = input.time * 3.0f;
+        input.geometry.rasterize([=](float x, float y) { return 0.5f + 0.5f * sin_fast(x * 0.7f + y * 0.35f - phase); }, value);
+    }
+
+    // sum of moving sine waves
+    void plasma(const animation::effect_input& input, float* value) {
+        const float t = input.time;
+        input.geometry.rasterize(
+            [=](float x, float y) {
+                float sum = sin_fast(x * 0.55f + t) + sin_fast(y * 0.8f - t * 1.3f) + sin_fast((x + y) * 0.35f + t * 0.7f);
+                return 0.5f + sum * (1.0f / 6.0f);
+            },
+            value);
+    }
+
+    // rising noise, hotter at the bottom
+    void fire(const animation::effect_input& input, float* value) {
+        const float scale = 1.0f / input.geometry.height;
+        const float rise = input.time * 3.0f;
+        input.geometry.rasterize(
+            [=](float x, float y) {
+                float heat = y * scale * 1.4f - 0.2f;
+                return clamp01((0.35f + 0.65f * noise(x * 0.9f, y * 0.9f + rise)) * heat);
+            },
+            value);
+    }
+
+    // text scrolling from right to left over the 5 lower rows
+    void marquee(const animation::effect_input& input, float* value) {
+        const std::vector<uint8_t>& text = input.text;
+        const int length = text.size();
+        const int period = length + static_cast<int>(input.geometry.width);
+        const float scroll = input.time * 8.0f - input.geometry.width;
+        input.geometry.rasterize(
+            [&](float x, float y) {
+                int column = static_cast<int>(floor_fast(x + scroll)) % period;
+                column += column < 0 ? period : 0;
+                int row = static_cast<int>(floor_fast(y - 1.5f));
+                uint8_t pixels = column < length ? text[column] : 0;
+                return row >= 0 && row < 5 ? static_cast<float>((pixels >> row) & 1) : 0.0f;
+            },
+            value);
+    }
+
+    // default palettes
+    using rgb_keyboard::color;
+    constexpr color rainbow_palette[] = {{0xff, 0x00, 0x00}, {0xff, 0xff, 0x00}, {0x00, 0xff, 0x00}, {0x00, 0xff, 0xff},
+                                         {0x00, 0x00, 0xff}, {0xff, 0x00, 0xff}, {0xff, 0x00, 0x00}};
+    constexpr color fire_palette[] = {{0x00, 0x00, 0x00}, {0x80, 0x00, 0x00}, {0xff, 0x20, 0x00}, {0xff, 0x80, 0x00}, {0xff, 0xff, 0xc0}};
+    constexpr color marquee_palette[] = {{0x00, 0x00, 0x00}, {0xff, 0xff, 0xff}};
+
+    struct effect_definition {
+        animation::effect_kernel kernel;
+        const color* palette;
+        std::size_t palette_size;
+    };
+
+    constexpr rgb_keyboard::static_table<effect_definition, 5> effect_table = {{
+        {"gradient", {gradient, rainbow_palette, std::size(rainbow_palette)}},
+        {"wave", {wave, rainbow_palette, std::size(rainbow_palette)}},
+        {"plasma", {plasma, rainbow_palette, std::size(rainbow_palette)}},
+        {"fire", {fire, fire_palette, std::size(fire_palette)}},
+        {"marquee", {marquee, marquee_palette, std::size(marquee_palette)}},
+    }};
+
+    // 3x5 pixel font, one row per byte (top to bottom), bit 2 is the left column
+    struct glyph {
+        char character;
+        uint8_t rows[5];
+    };
+    constexpr glyph font[] = {
+        {'A', {2, 5, 7, 5, 5}}, {'B', {6, 5, 6, 5, 6}}, {'C', {3, 4, 4, 4, 3}}, {'D', {6, 5, 5, 5, 6}}, {'E', {7, 4, 6, 4, 7}},
+        {'F', {7, 4, 6, 4, 4}}, {'G', {3, 4, 5, 5, 3}}, {'H', {5, 5, 7, 5, 5}}, {'I', {7, 2, 2, 2, 7}}, {'J', {1, 1, 1, 5, 2}},
+        {'K', {5, 5, 6, 5, 5}}, {'L', {4, 4, 4, 4, 7}}, {'M', {5, 7, 7, 5, 5}}, {'N', {6, 5, 5, 5, 5}}, {'O', {2, 5, 5, 5, 2}},
+        {'P', {6, 5, 6, 4, 4}}, {'Q', {2, 5, 5, 6, 3}}, {'R', {6, 5, 6, 5, 5}}, {'S', {3, 4, 2, 1, 6}}, {'T', {7, 2, 2, 2, 2}},
+        {'U', {5, 5, 5, 5, 7}}, {'V', {5, 5, 5, 5, 2}}, {'W', {5, 5, 7, 7, 5}}, {'X', {5, 5, 2, 5, 5}}, {'Y', {5, 5, 2, 2, 2}},
+        {'Z', {7, 1, 2, 4, 7}}, {'0', {7, 5, 5, 5, 7}}, {'1', {2, 6, 2, 2, 7}}, {'2', {6, 1, 2, 4, 7}}, {'3', {6, 1, 2, 1, 6}},
+        {'4', {5, 5, 7, 1, 1}}, {'5', {7, 4, 6, 1, 6}}, {'6', {3, 4, 7, 5, 7}}, {'7', {7, 1, 2, 2, 2}}, {'8', {7, 5, 7, 5, 7}},
+        {'9', {7, 5, 7, 1, 6}}, {' ', {0, 0, 0, 0, 0}}, {'!', {2, 2, 2, 0, 2}}, {'.', {0, 0, 0, 0, 2}}, {'-', {0, 0, 7, 0, 0}},
+        {'?', {6, 1, 2, 0, 2}}};
+
+    // render text to pixel columns, bit n of a column is row n
+    std::vector<uint8_t> render_text(std::string_view text) {
+        std::vector<uint8_t> columns;
+        for (char c : text) {
+            c = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+            const glyph* g = std::find_if(std::begin(font), std::end(font), [c](const glyph& g) { return g.character == c; });
+            if (g == std::end(font))
+                g = std::find_if(std::begin(font), std::end(font), [](const glyph& g) { return g.character == '?'; });
+
+            for (int column = 0; column < 3; column++) {
+                uint8_t bits = 0;
+                for (int row = 0; row < 5; row++)
+                    bits |= ((g->rows[row] >> (2 - column)) & 1) << row;
+                columns.push_back(bits);
+            }
+            columns.push_back(0);  // space between characters
+        }
+        return columns;
+    }
+}  // namespace
+
+rgb_keyboard::animation::animation(std::string_view effect, const key_geometry& geometry, const std::vector<color>& palette, std::string_view text)
+    : geometry(geometry), text_columns(render_text(text)) {
+    const effect_definition* definition = effect_table.find(effect);
+    if (definition == nullptr)
+        throw std::invalid_argument("Unknown effect: " + std::string(effect));
+    kernel = definition->kernel;
+
+    if (palette.empty())
+        this->palette = make_palette(std::vector<color>(definition->palette, definition->palette + definition->palette_size));
+    else
+        this->palette = make_palette(palette);
+}
+
+std::vector<std::string_view> rgb_keyboard::animation::effects() {
+    std::vector<std::string_view> result;
+    for (const auto& effect : effect_table)
+        result.push_back(effect.first);
+    return result;
+}
+
+rgb_keyboard::animation::palette_table rgb_keyboard::animation::make_palette(const std::vector<color>& colors) {
+    std::vector<color> points = colors;
+    if (points.size() == 1)
+        points.push_back(points[0]);
+
+    // interpolate between the two nearest colors
+    palette_table result;
+    for (int i = 0; i < 256; i++) {
+        float position = i / 255.0f * (points.size() - 1);
+        std::size_t first = std::min<std::size_t>(position, points.size() - 2);
+        float weight = position - first;
+        for (int channel = 0; channel < 3; channel++)
+            result[channel][i] = points[first][channel] + weight * (points[first + 1][channel] - points[first][channel]) + 0.5f;
+    }
+    return result;
+}
+
+void rgb_keyboard::animation::render(float time, key_framebuffer& colors) {
+    kernel({geometry, time, text_columns}, values.data());
+
+    // map values to palette entries
+    for (int i = 0; i < max_keys; i++) {
+        int index = static_cast<int>(clamp01(values[i]) * 255.0f + 0.5f);
+        channels[0][i] = palette[0][index];
+        channels[1][i] = palette[1][index];
+        channels[2][i] = palette[2][index];
+    }
+
+    colors.set(geometry.keys, channels[0].data(), channels[1].data(), channels[2].data());
+}
+
+rgb_keyboard::frame_pacer::statistics rgb_keyboard::animation::play(keyboard& kbd, int fps, clock::duration duration, const volatile std::sig_atomic_t& stop,
+                                                                    int layer) {
+    key_framebuffer frame;
+    auto show = [&] {
+        if (layer != 0)
+            kbd.set_layer(layer, frame);
+        else
+            kbd.set_custom_pattern(frame);
+    };
+
+    // first frame, then switch to the custom mode
+    render(0, frame);
+    show();
+    kbd.write_custom_mode();
+
+    // the first frame sent every key, the time it took gives the rate the keyboard sustains
+    if (fps == 0)
+        fps = std::clamp(static_cast<int>(kbd.get_sustainable_fps(geometry.keys.count())), 1, 1000);
+
+    frame_pacer pacer(fps);
+    const auto start = pacer.wait();
+    for (auto deadline = start; !stop; deadline = pacer.wait()) {
+        if (duration != clock::duration::zero() && deadline - start >= duration)
+            break;
+
+        // frames show the time of their deadline, late frames skip ahead instead of slowing down
+        render(std::chrono::duration<float>(deadline - start).count(), frame);
+        show();
+        pacer.rendered();
+        kbd.write_custom();
+        pacer.sent();
+    }
+
+    return pacer.get_statistics();
+}
@@ -0,0 +1,98 @@
+// host side animations for the custom led mode
+#ifndef RGB_KEYBOARD_ANIMATION
+#define RGB_KEYBOARD_ANIMATION
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "frame_pacer.h"
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * This class renders animated effects into custom key colors.
+     *
+     * An effect kernel computes a value between 0 and 1 for every key from the key positions
+     * and the time, in one loop over the structure of arrays key geometry. The values are
+     * mapped to colors with a 256 entry palette. Frames are streamed to the keyboard in the
+     * custom led mode, write_custom() only sends keys whose color changed.
+     */
+    class animation {
+     public:
+        using clock = std::chrono::steady_clock;
+
+        /// Input of an effect kernel
+        struct effect_input {
+            /// Key positions
+            const key_geometry& geometry;
+            /// Time since the start of the animation in seconds
+            float time;
+            /// Text of the marquee effect, one byte per pixel column, bit n is row n (top to bottom)
+            const std::vector<uint8_t>& text;
+        };
+        /// An effect kernel, stores a value between 0 and 1 for each key index in value
+        using effect_kernel = void (*)(const effect_input& input, float* value);
+
+        /** Create an animation
+         * \param effect Name of the effect, see effects()
+         * \param geometry Key positions of the keyboard
+         * \param palette Colors the effect values are mapped to (evenly spaced), empty for the default palette of the effect
+         * \param text Text of the marquee effect
+         * \throws std::invalid_argument if the effect is unknown
+         */
+        animation(std::string_view effect, const key_geometry& geometry, const std::vector<color>& palette = {}, std::string_view text = {});
+
+        /// Names of all effects
+        static std::vector<std::string_view> effects();
+
+        /// Palette as planar 256 entry lookup tables: red, green, blue
+        using palette_table = std::array<std::array<uint8_t, 256>, 3>;
+        /** Interpolate colors into a palette
+         * \param colors Colors of the palette, evenly spaced, at least one
+         */
+        static palette_table make_palette(const std::vector<color>& colors);
+
+        /** Render a frame
+         * \param time Seconds since the start of the animation
+         * \param colors Receives the colors of all keys of the geometry
+         */
+        void render(float time, key_framebuffer& colors);
+
+        /** Switch the keyboard to the custom led mode and stream frames
+         * Frames are rendered for their deadline, see frame_pacer.
+         * \param kbd The opened keyboard, frames are sent to its current profile
+         * \param fps Target frames per second, 0 for the rate the keyboard can sustain with all keys changing
+         * \param duration Stop after this time, 0 to run until stop is set
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \param layer Layer of the keyboard the frames are drawn into (see keyboard::add_layer()), 0 to replace the custom pattern
+         * \return Timing of the frames
+         */
+        frame_pacer::statistics play(keyboard& kbd, int fps, clock::duration duration, const volatile std::sig_atomic_t& stop, int layer = 0);
+
+     private:
+        /// Effect kernel
+        effect_kernel kernel;
+        /// Key positions
+        const key_geometry& geometry;
+        /// Palette lookup tables
+        palette_table palette;
+        /// Rendered text of the marquee effect
+        std::vector<uint8_t> text_columns;
+
+        /// Effect values of the current frame
+        alignas(64) std::array<float, max_keys> values{};
+        /// Colors of the current frame
+        alignas(64) std::array<std::array<uint8_t, max_keys>, 3> channels{};
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,99 @@
+// compares parse_keymap() with the regex based keymap loader it replaced
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+
+#include "../keymap_parser.h"
+
+namespace {
+    // the previous regex based parser, reduced to the parsing
+    std::size_t parse_regex(const std::string& text) {
+        std::map<std::string, std::string> keymap;
+        std::size_t actions = 0;
+
+        std::istringstream config_in(text);
+        std::string line, current_section = "";
+        while (std::getline(config_in, line)) {
+            if (line.length() == 0)
+                continue;
+            if (line[0] == ';' || line[0] == '#')
+                continue;
+
+            line = std::regex_replace(line, std::regex("[[:space:]]"), "");
+
+            if (std::regex_match(line, std::regex("\\[[[:print:]]+\\]"))) {
+                current_section = std::regex_replace(line, std::regex("[\\[\\]]"), "");
+                continue;
+            }
+
+            if (current_section == "keymap") {
+                if (std::regex_match(line, std::regex("[[:print:]]+=[[:print:]]+"))) {
+                    keymap.emplace(std::regex_replace(line, std::regex("=[[:print:]]+"), ""), std::regex_replace(line, std::regex("[[:print:]]+="), ""));
+                }
+            } else if (std::regex_match(current_section, std::regex("macro[0-9]+"))) {
+                if (std::regex_match(line, std::regex("repeat=[0-9]+")))
+                    continue;
+                if (!std::regex_match(line, std::regex("[[:print:]]+=[[:print:]]+=[[:print:]]+")))
+                    continue;
+
+                std::string type_string = std::regex_replace(line, std::regex("=[[:print:]]+=[[:print:]]+"), "");
+                std::string key = std::regex_replace(line, std::regex("[[:print:]]+?="), "", std::regex_constants::format_first_only);
+                key = std::regex_replace(key, std::regex("=[[:print:]]+"), "");
+                int delay = std::stoi(std::regex_replace(line, std::regex("[[:print:]]+=[[:print:]]+="), ""));
+                if ((type_string == "up" || type_string == "down") && delay >= 0)
+                    actions++;
+            }
+        }
+
+        return keymap.size() + actions;
+    }
+
+    std::size_t parse_tokenizer(const std::string& text) {
+        std::map<std::string, std::string> keymap;
+        auto config = rgb_keyboard::parse_keymap(text);
+        for (const auto& mapping : config.mappings)
+            keymap.emplace(mapping.key, mapping.function);
+        return keymap.size() + config.actions.size();
+    }
+
+    // a keymap file with the given number of mappings and macro actions
+    std::string generate(int lines) {
+        std::string text = "# generated keymap\n[keymap]\n";
+        for (int i = 0; i < lines / 2; i++)
+            text += "key" + std::to_string(i) + " = function" + std::to_string(i % 50) + "\n";
+        for (int i = 0; i < lines / 2; i++) {
+            if (i % 10 == 0)
+                text += "[macro" + std::to_string(i / 10 % 100 + 1) + "]\nrepeat=2\n";
+            text += std::string(i % 2 ? "up" : "down") + "=key" + std::to_string(i % 26) + "=" + std::to_string(i % 100) + "\n";
+        }
+        return text;
+    }
+
+    template <typename F>
+    double measure(F function, const std::string& text, std::size_t& result) {
+        auto start = std::chrono::steady_clock::now();
+        result = function(text);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}  // namespace
+
+int main(int argc, char** argv) {
+    int lines = argc > 1 ? std::stoi(argv[1]) : 5000;
+    std::string text = generate(lines);
+
+    std::size_t result_regex, result_tokenizer;
+    double time_regex = measure(parse_regex, text, result_regex);
+    double time_tokenizer = measure(parse_tokenizer, text, result_tokenizer);
+
+    std::cout << lines << " lines, " << text.size() << " bytes\n";
+    std::cout << "regex:     " << time_regex << " ms\n";
+    std::cout << "tokenizer: " << time_tokenizer << " ms (" << time_regex / time_tokenizer << "x faster)\n";
+    if (result_regex != result_tokenizer) {
+        std::cerr << "Results differ: " << result_regex << " != " << result_tokenizer << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include "color_calibration.h"
+
+#include <cmath>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    // settings of one section of a calibration file
+    struct calibration_settings {
+        std::optional<double> gamma;
+        std::optional<rgb_keyboard::color> white;
+        std::array<std::optional<rgb_keyboard::color_calibration::table>, 3> tables;
+
+        // copy all settings that are set in other
+        void merge(const calibration_settings& other) {
+            if (other.gamma)
+                gamma = other.gamma;
+            if (other.white)
+                white = other.white;
+            for (int i = 0; i < 3; i++) {
+                if (other.tables[i])
+                    tables[i] = other.tables[i];
+            }
+        }
+    };
+
+    // throws std::invalid_argument with the line number
+    [[noreturn]] void invalid_line(int number, const std::string& message) {
+        throw std::invalid_argument("Calibration file line " + std::to_string(number) + ": " + message);
+    }
+}  // namespace
+
+rgb_keyboard::color_calibration::color_calibration() {
+    for (auto& channel : tables) {
+        for (int i = 0; i < 256; i++)
+            channel[i] = i;
+    }
+    update();
+}
+
+int rgb_keyboard::color_calibration::load(const std::string& file, std::string_view model, std::string_view serial) {
+    // open file
+    std::ifstream config_in(file);
+    if (!config_in.is_open()) {
+        return 1;
+    }
+
+    // settings for all keyboards, this model and this keyboard
+    calibration_settings global, for_model, for_serial;
+    calibration_settings* section = &global;
+    calibration_settings ignored;
+
+    int number = 0;
+    for (std::string line; std::getline(config_in, line);) {
+        number++;
+
+        std::istringstream tokens(line);
+        std::string key;
+        if (!(tokens >> key) || key[0] == '#')
+            continue;
+
+        // section header
+        if (key.front() == '[' && key.back() == ']') {
+            std::string_view name = std::string_view(key).substr(1, key.size() - 2);
+            if (name.substr(0, 6) == "model:")
+                section = name.substr(6) == model ? &for_model : &ignored;
+            else if (name.substr(0, 7) == "serial:")
+                section = !serial.empty() && name.substr(7) == serial ? &for_serial : &ignored;
+            else
+                invalid_line(number, "unknown section " + key);
+            continue;
+        }
+
+        if (key == "gamma") {
+            double value = 0;
+            if (!(tokens >> value) || value <= 0)
+                invalid_line(number, "gamma must be a positive number");
+            section->gamma = value;
+
+        } else if (key == "white") {
+            std::string value;
+            if (!(tokens >> value) || value.size() != 6 || value.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+                invalid_line(number, "white must be a color (rrggbb)");
+            section->white = color{static_cast<uint8_t>(std::stoi(value.substr(0, 2), nullptr, 16)), static_cast<uint8_t>(std::stoi(value.substr(2, 2), nullptr, 16)),
+                                   static_cast<uint8_t>(std::stoi(value.substr(4, 2), nullptr, 16))};
+
+        } else if (key == "red" || key == "green" || key == "blue") {
+            table values;
+            for (auto& entry : values) {
+                int value = 0;
+                if (!(tokens >> value) || value < 0 || value > 255)
+                    invalid_line(number, key + " must be 256 numbers (0-255)");
+                entry = value;
+            }
+            section->tables[key == "red" ? 0 : key == "green" ? 1 : 2] = values;
+
+        } else {
+            invalid_line(number, "unknown setting " + key);
+        }
+    }
+
+    // more specific sections override the global settings
+    global.merge(for_model);
+    global.merge(for_serial);
+
+    gamma = global.gamma.value_or(1.0);
+    white = global.white.value_or(color{0xff, 0xff, 0xff});
+    for (int i = 0; i < 3; i++) {
+        if (global.tables[i]) {
+            tables[i] = *global.tables[i];
+        } else {
+            for (int j = 0; j < 256; j++)
+                tables[i][j] = j;
+        }
+    }
+    update();
+
+    return 0;
+}
+
+void rgb_keyboard::color_calibration::set_gamma(double gamma) {
+    if (gamma <= 0)
+        throw std::invalid_argument("Invalid gamma");
+
+    this->gamma = gamma;
+    update();
+}
+
+void rgb_keyboard::color_calibration::set_white_point(const color& white) {
+    this->white = white;
+    update();
+}
+
+void rgb_keyboard::color_calibration::set_table(int channel, const table& values) {
+    if (channel < 0 || channel > 2)
+        throw std::invalid_argument("Invalid color channel");
+
+    tables[channel] = values;
+    update();
+}
+
+rgb_keyboard::color rgb_keyboard::color_calibration::apply(const color& value) const {
+    return {combined[0][value[0]], combined[1][value[1]], combined[2][value[2]]};
+}
+
+const rgb_keyboard::key_framebuffer& rgb_keyboard::color_calibration::apply(const key_framebuffer& colors) const {
+    // nothing to do
+    if (identity)
+        return colors;
+
+    // same colors as last time?
+    if (cache_valid && cache_source == colors)
+        return cache_result;
+
+    cache_source = colors;
+    cache_result = colors;
+    cache_result.map(combined);
+    cache_valid = true;
+
+    return cache_result;
+}
+
+void rgb_keyboard::color_calibration::update() {
+    identity = true;
+    for (int channel = 0; channel < 3; channel++) {
+        for (int i = 0; i < 256; i++) {
+            // gamma curve and white point, then the user supplied table
+            double value = std::pow(i / 255.0, gamma) * white[channel];
+            combined[channel][i] = tables[channel][static_cast<uint8_t>(std::lround(value))];
+
+            identity = identity && combined[channel][i] == i;
+        }
+    }
+
+    cache_valid = false;
+}
@@ -0,0 +1,87 @@
+// color calibration for the keyboard leds
+#ifndef RGB_KEYBOARD_COLOR_CALIBRATION
+#define RGB_KEYBOARD_COLOR_CALIBRATION
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class corrects colors before they are sent to the keyboard.
+     *
+     * The correction consists of a gamma curve, a white point (scaling of each channel)
+     * and optional lookup tables, in this order. All three steps are combined into one
+     * 256 entry table per channel, so correcting a color costs one lookup per channel.
+     */
+    class color_calibration {
+     public:
+        /// Lookup table of one color channel
+        using table = std::array<uint8_t, 256>;
+
+        /// Create a calibration that does not change any color
+        color_calibration();
+
+        /** Load a calibration file
+         *
+         * Settings before the first section apply to all keyboards, settings in a [model:id] section
+         * apply to one model (see device_model::id) and override the global settings, settings in a
+         * [serial:serial number] section apply to one keyboard and override all others.
+         * \param file Path of the calibration file
+         * \param model Model id of the keyboard
+         * \param serial USB serial number of the keyboard, can be empty
+         * \return 0 if successful
+         * \throws std::invalid_argument if the file contains invalid settings
+         */
+        int load(const std::string& file, std::string_view model, std::string_view serial);
+
+        /// Set the exponent of the gamma curve, 1.0 is linear
+        void set_gamma(double gamma);
+        /// Set the color that is displayed for white (ffffff)
+        void set_white_point(const color& white);
+        /// Set the lookup table of a channel (0: red, 1: green, 2: blue), applied after gamma and white point
+        void set_table(int channel, const table& values);
+
+        /// Returns true if the calibration does not change any color
+        [[nodiscard]] bool is_identity() const { return identity; }
+        /// Get the combined lookup table of a channel
+        [[nodiscard]] const table& get_table(int channel) const { return combined[channel]; }
+
+        /// Correct a single color
+        [[nodiscard]] color apply(const color& value) const;
+        /** Correct all keys of a framebuffer
+         * The result is cached, correcting the same colors again does not recompute anything.
+         * \return The corrected framebuffer, valid until the next call
+         */
+        const key_framebuffer& apply(const key_framebuffer& colors) const;
+
+     private:
+        /// Recompute the combined tables
+        void update();
+
+        /// Exponent of the gamma curve
+        double gamma = 1.0;
+        /// Displayed color for white
+        color white = {0xff, 0xff, 0xff};
+        /// Lookup tables set by the user
+        std::array<table, 3> tables;
+        /// Gamma, white point and lookup table of each channel combined
+        std::array<table, 3> combined;
+        /// Are all combined tables the identity?
+        bool identity = true;
+
+        /// Input of the last apply(const key_framebuffer&)
+        mutable key_framebuffer cache_source;
+        /// Output of the last apply(const key_framebuffer&)
+        mutable key_framebuffer cache_result;
+        /// Are cache_source and cache_result valid?
+        mutable bool cache_valid = false;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,187 @@
+#include "compositor.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "static_table.h"
+
+namespace {
+    using rgb_keyboard::compositor;
+
+    constexpr rgb_keyboard::static_table<compositor::blend_modes, 5> blend_mode_table = {{
+        {"normal", compositor::blend_modes::normal},
+        {"add", compositor::blend_modes::add},
+        {"multiply", compositor::blend_modes::multiply},
+        {"screen", compositor::blend_modes::screen},
+        {"max", compositor::blend_modes::max},
+    }};
+
+    // keys per block, the bits of one key_set word
+    constexpr int block_size = 64;
+
+    // x / 255 rounded, exact for 0 <= x <= 255 * 255
+    inline int div255(int x) {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    /* Blend a block of source colors onto destination colors
+     * mix(destination, source) is the color of the blend mode, it is faded in with the alpha value.
+     * The loop has no branches and a fixed length, so it is vectorized for each mode.
+     */
+    template <typename F>
+    void blend_keys(uint8_t* __restrict r, uint8_t* __restrict g, uint8_t* __restrict b, const uint8_t* __restrict sr, const uint8_t* __restrict sg,
+                    const uint8_t* __restrict sb, const uint8_t* __restrict alpha, int opacity, F mix) {
+        for (int i = 0; i < block_size; i++) {
+            int a = div255(alpha[i] * opacity);
+            r[i] = div255(r[i] * (255 - a) + mix(r[i], sr[i]) * a);
+            g[i] = div255(g[i] * (255 - a) + mix(g[i], sg[i]) * a);
+            b[i] = div255(b[i] * (255 - a) + mix(b[i], sb[i]) * a);
+        }
+    }
+}  // namespace
+
+rgb_keyboard::compositor::blend_modes rgb_keyboard::compositor::parse_blend_mode(std::string_view name) {
+    const blend_modes* mode = blend_mode_table.find(name);
+    if (mode == nullptr)
+        throw std::invalid_argument("Unknown blend mode: " + std::string(name));
+    return *mode;
+}
+
+int rgb_keyboard::compositor::add_layer(blend_modes mode, uint8_t opacity) {
+    layer added;
+    added.id = next_id++;
+    added.mode = mode;
+    added.opacity = opacity;
+    layers.push_back(added);
+    return added.id;
+}
+
+void rgb_keyboard::compositor::remove_layer(int id) {
+    if (layer* l = find(id))
+        dirty = dirty | l->keys;
+    layers.erase(std::remove_if(layers.begin(), layers.end(), [id](const layer& l) { return l.id == id; }), layers.end());
+}
+
+rgb_keyboard::compositor::layer* rgb_keyboard::compositor::find(int id) {
+    auto found = std::find_if(layers.begin(), layers.end(), [id](const layer& l) { return l.id == id; });
+    return found != layers.end() ? &*found : nullptr;
+}
+
+void rgb_keyboard::compositor::set_layer(int id, const key_framebuffer& colors) {
+    std::array<uint8_t, max_keys> opaque;
+    opaque.fill(255);
+    set_layer(id, colors, opaque.data());
+}
+
+void rgb_keyboard::compositor::set_layer(int id, const key_framebuffer& colors, const uint8_t* alpha) {
+    layer* l = find(id);
+    if (l == nullptr)
+        return;
+
+    // only keys whose color or alpha value changed have to be blended again
+    const key_set keys = colors.keys();
+    key_set visible;
+    for (int key = 0; key < max_keys; key++) {
+        const bool set = keys.test(key);
+        const uint8_t value[4] = {uint8_t(set ? colors.red()[key] : 0), uint8_t(set ? colors.green()[key] : 0),
+                                  uint8_t(set ? colors.blue()[key] : 0), uint8_t(set ? alpha[key] : 0)};
+        bool changed = false;
+        for (int channel = 0; channel < 4; channel++) {
+            changed = changed || l->channels[channel][key] != value[channel];
+            l->channels[channel][key] = value[channel];
+        }
+        if (changed)
+            dirty.set(key);
+        if (value[3] != 0)
+            visible.set(key);
+    }
+    l->keys = visible;
+}
+
+void rgb_keyboard::compositor::set_blend_mode(int id, blend_modes mode) {
+    if (layer* l = find(id); l != nullptr && l->mode != mode) {
+        l->mode = mode;
+        dirty = dirty | l->keys;
+    }
+}
+
+void rgb_keyboard::compositor::set_opacity(int id, uint8_t opacity) {
+    if (layer* l = find(id); l != nullptr && l->opacity != opacity) {
+        l->opacity = opacity;
+        dirty = dirty | l->keys;
+    }
+}
+
+void rgb_keyboard::compositor::blend(const layer& source, int begin) {
+    uint8_t* r = work[0].data() + begin;
+    uint8_t* g = work[1].data() + begin;
+    uint8_t* b = work[2].data() + begin;
+    const uint8_t* sr = source.channels[0].data() + begin;
+    const uint8_t* sg = source.channels[1].data() + begin;
+    const uint8_t* sb = source.channels[2].data() + begin;
+    const uint8_t* alpha = source.channels[3].data() + begin;
+    const int opacity = source.opacity;
+
+    switch (source.mode) {
+        case blend_modes::normal:
+            blend_keys(r, g, b, sr, sg, sb, alpha, opacity, [](int, int s) { return s; });
+            break;
+        case blend_modes::add:
+            blend_keys(r, g, b, sr, sg, sb, alpha, opacity, [](int d, int s) { return std::min(d + s, 255); });
+            break;
+        case blend_modes::multiply:
+            blend_keys(r, g, b, sr, sg, sb, alpha, opacity, [](int d, int s) { return div255(d * s); });
+            break;
+        case blend_modes::screen:
+            blend_keys(r, g, b, sr, sg, sb, alpha, opacity, [](int d, int s) { return 255 - div255((255 - d) * (255 - s)); });
+            break;
+        case blend_modes::max:
+            blend_keys(r, g, b, sr, sg, sb, alpha, opacity, [](int d, int s) { return std::max(d, s); });
+            break;
+    }
+}
+
+const rgb_keyboard::key_framebuffer& rgb_keyboard::compositor::compose(const key_framebuffer& base) {
+    // keys whose base color changed
+    const key_set base_keys = base.keys();
+    const key_set old_keys = base_copy.keys();
+    dirty = dirty | (base_keys - old_keys) | (old_keys - base_keys);
+    base.for_each([&](int key) {
+        if (old_keys.test(key) && base.get(key) != base_copy.get(key))
+            dirty.set(key);
+    });
+    base_copy = base;
+
+    key_set covered = base_keys;
+    for (const auto& l : layers)
+        covered = covered | l.keys;
+
+    // blend the blocks with a changed key
+    for (std::size_t word = 0; word < dirty.words.size(); word++) {
+        if (dirty.words[word] == 0)
+            continue;
+        const int begin = word * block_size;
+
+        // keys without a base color start black
+        for (int i = begin; i < begin + block_size; i++) {
+            const uint8_t mask = -static_cast<uint8_t>((base_keys.words[word] >> (i - begin)) & 1);
+            work[0][i] = base.red()[i] & mask;
+            work[1][i] = base.green()[i] & mask;
+            work[2][i] = base.blue()[i] & mask;
+        }
+        for (const auto& l : layers)
+            blend(l, begin);
+    }
+
+    result.set(dirty & covered, work[0].data(), work[1].data(), work[2].data());
+    const key_set uncovered = dirty - covered;
+    for (int key = 0; key < max_keys; key++) {
+        if (uncovered.test(key))
+            result.unset(key);
+    }
+    dirty = {};
+
+    return result;
+}
@@ -0,0 +1,108 @@
+// layers of key colors blended on top of each other
+#ifndef RGB_KEYBOARD_COMPOSITOR
+#define RGB_KEYBOARD_COMPOSITOR
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class blends layers of key colors on top of a base pattern.
+     *
+     * Each layer has a color and an alpha value (0 transparent - 255 opaque) per key, an opacity
+     * and a blend mode. Layers added later are blended on top. The colors are stored in planar form
+     * like key_framebuffer, the blend loops run over all keys of a 64 key block. Only blocks with a
+     * key that changed since the last compose() are blended again.
+     */
+    class compositor {
+     public:
+        /// How the color of a layer is combined with the colors below
+        enum class blend_modes {
+            /// The layer color
+            normal,
+            /// Sum, limited to 255
+            add,
+            /// Product, darkens
+            multiply,
+            /// Inverted product of the inverted colors, brightens
+            screen,
+            /// Maximum of each channel
+            max
+        };
+
+        /** Parse the name of a blend mode
+         * \throws std::invalid_argument if the name is unknown
+         */
+        static blend_modes parse_blend_mode(std::string_view name);
+
+        /** Add a layer on top of all others, initially transparent
+         * \param mode Blend mode
+         * \param opacity Multiplied with the alpha value of each key
+         * \return Id of the layer
+         */
+        int add_layer(blend_modes mode = blend_modes::normal, uint8_t opacity = 255);
+        /// Remove a layer
+        void remove_layer(int id);
+        /// Returns true if there are no layers
+        [[nodiscard]] bool empty() const { return layers.empty(); }
+
+        /** Set the colors of a layer, keys with a color are opaque, the other keys transparent
+         * Unknown ids are ignored.
+         */
+        void set_layer(int id, const key_framebuffer& colors);
+        /** Set the colors and alpha values of a layer
+         * \param alpha max_keys alpha values, indexed by the key index, keys without a color are transparent
+         */
+        void set_layer(int id, const key_framebuffer& colors, const uint8_t* alpha);
+        /// Change the blend mode of a layer
+        void set_blend_mode(int id, blend_modes mode);
+        /// Change the opacity of a layer
+        void set_opacity(int id, uint8_t opacity);
+
+        /** Blend all layers on top of a base pattern
+         * Keys without a color in base and in all layers have no color in the result.
+         * \param base Bottom layer, opaque
+         * \return The blended colors, valid until the next call
+         */
+        const key_framebuffer& compose(const key_framebuffer& base);
+
+     private:
+        /// A layer
+        struct layer {
+            int id;
+            blend_modes mode;
+            uint8_t opacity;
+            /// red, green, blue, alpha
+            alignas(64) std::array<std::array<uint8_t, max_keys>, 4> channels{};
+            /// Keys with an alpha value above 0
+            key_set keys;
+        };
+
+        /// Layer with an id, nullptr if it doesn't exist
+        layer* find(int id);
+        /// Blend a layer onto the working colors of the 64 keys starting at begin
+        void blend(const layer& source, int begin);
+
+        /// All layers, the last one is on top
+        std::vector<layer> layers;
+        /// Id of the next layer
+        int next_id = 1;
+
+        /// The base pattern of the last compose()
+        key_framebuffer base_copy;
+        /// The result of the last compose()
+        key_framebuffer result;
+        /// Keys whose result has to be recomputed
+        key_set dirty;
+        /// Working colors: red, green, blue
+        alignas(64) std::array<std::array<uint8_t, max_keys>, 3> work{};
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,121 @@
+#include "config_checker.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <tuple>
+
+#include "keymap_parser.h"
+#include "mapped_file.h"
+#include "packet_program.h"
+#include "rgb_keyboard.h"
+
+namespace {
+    using rgb_keyboard::check_result;
+    using rgb_keyboard::parse_diagnostic;
+
+    // diagnostic at a position inside text
+    parse_diagnostic diagnostic_at(std::string_view text, std::string_view position, std::string message) {
+        std::size_t offset = position.data() - text.data();
+        std::size_t line = 1 + std::count(text.begin(), text.begin() + offset, '\n');
+        std::size_t line_start = offset == 0 ? std::string_view::npos : text.rfind('\n', offset - 1);
+        std::size_t column = line_start == std::string_view::npos ? offset + 1 : offset - line_start;
+        return {line, column, std::move(message)};
+    }
+
+    // check key and function names of a keymap
+    void check_keymap(std::string_view text, const rgb_keyboard::device_model& model, check_result& result) {
+        auto config = rgb_keyboard::parse_keymap(text);
+        result.diagnostics = std::move(config.diagnostics);
+
+        if (model.keymap_offsets == nullptr) {
+            result.diagnostics.push_back({1, 1, std::string("Remapping is not supported on the ") + model.name});
+            return;
+        }
+
+        for (const auto& mapping : config.mappings) {
+            if (!rgb_keyboard::keyboard::get_keymap_key_valid(mapping.key))
+                result.diagnostics.push_back(diagnostic_at(text, mapping.key, "Unknown key '" + std::string(mapping.key) + "'"));
+            if (!rgb_keyboard::keyboard::get_keymap_option_valid(mapping.function))
+                result.diagnostics.push_back(diagnostic_at(text, mapping.function, "Unknown function '" + std::string(mapping.function) + "'"));
+        }
+
+        std::sort(result.diagnostics.begin(), result.diagnostics.end(),
+                  [](const auto& a, const auto& b) { return std::tie(a.line, a.column) < std::tie(b.line, b.column); });
+    }
+
+    // check one file, compile it if output is not empty
+    void check_file(check_result& result, const rgb_keyboard::device_model& model, int profile, const std::filesystem::path& output) {
+        rgb_keyboard::mapped_file file(result.file);
+        if (!file.is_open()) {
+            result.error = "Couldn't open file";
+            return;
+        }
+
+        rgb_keyboard::keyboard kbd;
+        kbd.select_model(model);
+        kbd.set_profile(profile);
+
+        rgb_keyboard::key_framebuffer colors;
+        if (result.kind == check_result::pattern)
+            result.diagnostics = rgb_keyboard::parse_pattern(file.text(), rgb_keyboard::pattern_syntax::file, colors);
+        else
+            check_keymap(file.text(), kbd.get_device_model(), result);
+
+        if (output.empty() || !result.ok())
+            return;
+
+        // capture the packets the settings would send
+        kbd.begin_capture();
+        if (result.kind == check_result::pattern) {
+            kbd.set_custom_pattern(colors);
+            kbd.write_custom();
+            kbd.set_mode(rgb_keyboard::keyboard::modes::custom);
+            kbd.write_mode();
+        } else {
+            // the keymap was checked, loading it again can't fail
+            kbd.load_keymap(result.file);
+            kbd.write_key_mapping_ansi();
+        }
+        rgb_keyboard::packet_program program(kbd.get_device_model().program_model, profile, kbd.end_capture());
+
+        std::error_code error;
+        std::filesystem::create_directories(output.parent_path(), error);
+        if (program.save(output.string()) != 0) {
+            result.error = "Couldn't write packet program " + output.string();
+            return;
+        }
+        result.program = output.string();
+    }
+}  // namespace
+
+std::vector<rgb_keyboard::check_result> rgb_keyboard::check_configs(const std::string& directory, const device_model& model, int profile,
+                                                                    const std::string& output_directory, thread_pool& pool) {
+    // find all configuration files, sorted for a deterministic order
+    std::vector<check_result> results;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+        if (!entry.is_regular_file())
+            continue;
+
+        const auto extension = entry.path().extension();
+        if (extension == ".conf")
+            results.push_back({entry.path().string(), check_result::pattern, {}, {}, {}});
+        else if (extension == ".keymap")
+            results.push_back({entry.path().string(), check_result::keymap, {}, {}, {}});
+    }
+    std::sort(results.begin(), results.end(), [](const auto& a, const auto& b) { return a.file < b.file; });
+
+    // each file is checked independently, the results don't depend on the order
+    pool.parallel_for(results.size(), [&](std::size_t i) {
+        std::filesystem::path output;
+        if (!output_directory.empty())
+            output = std::filesystem::path(output_directory) / (std::filesystem::relative(results[i].file, directory).string() + ".prog");
+
+        try {
+            check_file(results[i], model, profile, output);
+        } catch (std::exception& e) {
+            results[i].error = e.what();
+        }
+    });
+
+    return results;
+}
@@ -0,0 +1,57 @@
+// parallel checking and compiling of configuration directories
+#ifndef RGB_KEYBOARD_CONFIG_CHECKER
+#define RGB_KEYBOARD_CONFIG_CHECKER
+
+#include <string>
+#include <vector>
+
+#include "device_models.h"
+#include "pattern_parser.h"
+#include "thread_pool.h"
+
+namespace rgb_keyboard {
+
+    /// Result of checking one configuration file
+    struct check_result {
+        /// Kind of configuration file, determined by the extension
+        enum kinds {
+            /// Custom led pattern (.conf)
+            pattern,
+            /// Keymap (.keymap)
+            keymap
+        };
+
+        /// Path of the file
+        std::string file;
+        /// Kind of the file
+        kinds kind;
+        /// Malformed lines, unknown key and option names
+        std::vector<parse_diagnostic> diagnostics;
+        /// Set if the file couldn't be read or the program couldn't be written
+        std::string error;
+        /// Path of the compiled packet program, empty if none was written
+        std::string program;
+
+        /// Returns true if there are no diagnostics and no error
+        [[nodiscard]] bool ok() const { return diagnostics.empty() && error.empty(); }
+    };
+
+    /** Check all configuration files in a directory tree in parallel
+     *
+     * Custom patterns (*.conf) and keymaps (*.keymap) are parsed, key names and options are checked
+     * against the tables of the model. Valid files are optionally compiled to packet programs, stored
+     * in output_directory with the same relative path and .prog appended. A pattern program sets
+     * the custom led mode with the pattern.
+     * \param directory Root of the directory tree
+     * \param model Target keyboard model
+     * \param profile Profile (1-3) the programs are compiled for
+     * \param output_directory Where to store the programs, empty to only check the files
+     * \param pool Threads used for checking
+     * \return One result for each file, sorted by path (independent of the number of threads)
+     * \throws std::filesystem::filesystem_error if the directory can't be read
+     */
+    std::vector<check_result> check_configs(const std::string& directory, const device_model& model, int profile, const std::string& output_directory, thread_pool& pool);
+
+}  // namespace rgb_keyboard
+
+#endif
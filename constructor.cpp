@@ -9,4 +9,5 @@ rgb_keyboard::keyboard::keyboard() {
     speed.fill(1);
     profile = 1;
     active_profile = 1;
+    select_model(device_model_of<standard_model>);
 }
@@ -1,7 +1,7 @@
 #include "rgb_keyboard.h"
 
 // keycodes for custom led patterns
-const std::map<std::string_view, std::array<uint8_t, 3>> rgb_keyboard::keyboard::keycodes = {
+constexpr rgb_keyboard::led_key_table keycode_table = {{
     {"Esc", {0x57, 0x03, 0x00}},        {"F1", {0x5a, 0x06, 0x00}},         {"F2", {0x5d, 0x09, 0x00}},
     {"F3", {0x60, 0x0c, 0x00}},         {"F4", {0x63, 0x0f, 0x00}},         {"F5", {0x66, 0x12, 0x00}},
     {"F6", {0x69, 0x15, 0x00}},         {"F7", {0x6c, 0x18, 0x00}},         {"F8", {0x6f, 0x1b, 0x00}},
@@ -36,10 +36,65 @@ const std::map<std::string_view, std::array<uint8_t, 3>> rgb_keyboard::keyboard:
     {"Num_9", {0xea, 0x96, 0x00}},      {"Num_Plus", {0xb4, 0x5f, 0x01}},   {"Num_4", {0x17, 0xc3, 0x00}},
     {"Num_5", {0x1a, 0xc6, 0x00}},      {"Num_6", {0x1d, 0xc9, 0x00}},      {"Num_1", {0x4a, 0xf6, 0x00}},
     {"Num_2", {0x4d, 0xf9, 0x00}},      {"Num_3", {0x50, 0xfc, 0x00}},      {"Num_0", {0x7e, 0x29, 0x01}},
-    {"Num_Period", {0x81, 0x2c, 0x01}}, {"Num_Return", {0x84, 0x2f, 0x01}}, {"Int_Key", {0x4f, 0x3b, 0x01}}};
+    {"Num_Period", {0x81, 0x2c, 0x01}}, {"Num_Return", {0x84, 0x2f, 0x01}}, {"Int_Key", {0x4f, 0x3b, 0x01}}}};
+const rgb_keyboard::led_key_table& rgb_keyboard::full_size_led_layout::keycodes = keycode_table;
+
+// checksum byte of the custom led packet for each key index, from keycodes
+constexpr std::array<uint8_t, rgb_keyboard::max_keys> led_checksum_table = [] {
+    std::array<uint8_t, rgb_keyboard::max_keys> result{};
+    for (const auto& element : keycode_table)
+        result[(element.second[1] | (element.second[2] << 8)) / 3] = element.second[0];
+    return result;
+}();
+const std::array<uint8_t, rgb_keyboard::max_keys>& rgb_keyboard::full_size_led_layout::led_checksums = led_checksum_table;
+
+// key centers and sizes of the full size ANSI layout, in key units
+struct key_position {
+    std::string_view name;
+    float x, y;
+    float w = 1, h = 1;
+};
+constexpr key_position full_size_positions[] = {
+    // function key row
+    {"Esc", 0.5, 0.5}, {"F1", 2.5, 0.5}, {"F2", 3.5, 0.5}, {"F3", 4.5, 0.5}, {"F4", 5.5, 0.5}, {"F5", 7.0, 0.5}, {"F6", 8.0, 0.5}, {"F7", 9.0, 0.5},
+    {"F8", 10.0, 0.5}, {"F9", 11.5, 0.5}, {"F10", 12.5, 0.5}, {"F11", 13.5, 0.5}, {"F12", 14.5, 0.5}, {"PrtSc", 15.75, 0.5}, {"ScrLk", 16.75, 0.5},
+    {"Pause", 17.75, 0.5},
+    // number row
+    {"Tilde", 0.5, 2.0}, {"1", 1.5, 2.0}, {"2", 2.5, 2.0}, {"3", 3.5, 2.0}, {"4", 4.5, 2.0}, {"5", 5.5, 2.0}, {"6", 6.5, 2.0}, {"7", 7.5, 2.0},
+    {"8", 8.5, 2.0}, {"9", 9.5, 2.0}, {"0", 10.5, 2.0}, {"Minus", 11.5, 2.0}, {"Equals", 12.5, 2.0}, {"Backspace", 14.0, 2.0, 2.0}, {"Insert", 15.75, 2.0},
+    {"Home", 16.75, 2.0}, {"PgUp", 17.75, 2.0}, {"Num_Lock", 19.0, 2.0}, {"Num_Slash", 20.0, 2.0}, {"Num_Asterisk", 21.0, 2.0}, {"Num_Minus", 22.0, 2.0},
+    // top letter row
+    {"Tab", 0.75, 3.0, 1.5}, {"q", 2.0, 3.0}, {"w", 3.0, 3.0}, {"e", 4.0, 3.0}, {"r", 5.0, 3.0}, {"t", 6.0, 3.0}, {"y", 7.0, 3.0}, {"u", 8.0, 3.0},
+    {"i", 9.0, 3.0}, {"o", 10.0, 3.0}, {"p", 11.0, 3.0}, {"Bracket_l", 12.0, 3.0}, {"Bracket_r", 13.0, 3.0}, {"Backslash", 14.25, 3.0, 1.5},
+    {"Delete", 15.75, 3.0}, {"End", 16.75, 3.0}, {"PgDn", 17.75, 3.0}, {"Num_7", 19.0, 3.0}, {"Num_8", 20.0, 3.0}, {"Num_9", 21.0, 3.0},
+    {"Num_Plus", 22.0, 3.5, 1.0, 2.0},
+    // home row
+    {"Caps_Lock", 0.875, 4.0, 1.75}, {"a", 2.25, 4.0}, {"s", 3.25, 4.0}, {"d", 4.25, 4.0}, {"f", 5.25, 4.0}, {"g", 6.25, 4.0}, {"h", 7.25, 4.0},
+    {"j", 8.25, 4.0}, {"k", 9.25, 4.0}, {"l", 10.25, 4.0}, {"Semicolon", 11.25, 4.0}, {"Apostrophe", 12.25, 4.0}, {"Return", 13.875, 4.0, 2.25},
+    {"Num_4", 19.0, 4.0}, {"Num_5", 20.0, 4.0}, {"Num_6", 21.0, 4.0},
+    // bottom letter row, Int_Key doesn't exist on ANSI keyboards
+    {"Shift_l", 1.125, 5.0, 2.25}, {"z", 2.75, 5.0}, {"x", 3.75, 5.0}, {"c", 4.75, 5.0}, {"v", 5.75, 5.0}, {"b", 6.75, 5.0}, {"n", 7.75, 5.0},
+    {"m", 8.75, 5.0}, {"Comma", 9.75, 5.0}, {"Period", 10.75, 5.0}, {"Slash", 11.75, 5.0}, {"Shift_r", 13.625, 5.0, 2.75}, {"Up", 16.75, 5.0},
+    {"Num_1", 19.0, 5.0}, {"Num_2", 20.0, 5.0}, {"Num_3", 21.0, 5.0}, {"Num_Return", 22.0, 5.5, 1.0, 2.0},
+    // space bar row
+    {"Ctrl_l", 0.625, 6.0, 1.25}, {"Super_l", 1.875, 6.0, 1.25}, {"Alt_l", 3.125, 6.0, 1.25}, {"Space", 6.875, 6.0, 6.25}, {"Alt_r", 10.625, 6.0, 1.25}, {"Fn", 11.875, 6.0, 1.25},
+    {"Menu", 13.125, 6.0, 1.25}, {"Ctrl_r", 14.375, 6.0, 1.25}, {"Left", 15.75, 6.0}, {"Down", 16.75, 6.0}, {"Right", 17.75, 6.0}, {"Num_0", 19.5, 6.0, 2.0},
+    {"Num_Period", 21.0, 6.0}};
+
+// key geometry of the full size layout, from full_size_positions and keycodes
+constexpr rgb_keyboard::key_geometry full_size_geometry_table = [] {
+    rgb_keyboard::key_geometry result;
+    for (const auto& position : full_size_positions) {
+        const auto* address = keycode_table.find(position.name);
+        result.add(((*address)[1] | ((*address)[2] << 8)) / 3, position.x, position.y, position.w, position.h);
+    }
+    result.finish();
+    return result;
+}();
+const rgb_keyboard::key_geometry& rgb_keyboard::full_size_led_layout::geometry = full_size_geometry_table;
 
 // keycodes/data offsets for keymapping
-const std::map<std::string_view, std::array<std::array<uint8_t, 2>, 3>> rgb_keyboard::keyboard::keymap_offsets = {
+constexpr rgb_keyboard::keymap_key_table keymap_offset_table = {{
     {"Esc", {{{1, 11}, {1, 12}, {1, 13}}}},
     {"F1", {{{1, 14}, {1, 15}, {1, 16}}}},
     {"F2", {{{1, 17}, {1, 18}, {1, 19}}}},
@@ -144,10 +199,11 @@ const std::map<std::string_view, std::array<std::array<uint8_t, 2>, 3>> rgb_keyb
     {"Num_0", {{{6, 25}, {6, 26}, {6, 27}}}},
     {"Num_Period", {{{6, 28}, {6, 29}, {6, 30}}}},
     {"Num_Return", {{{6, 31}, {6, 32}, {6, 33}}}},
-    {"Int_Key", {{{7, 44}, {7, 45}, {7, 46}}}}};
+    {"Int_Key", {{{7, 44}, {7, 45}, {7, 46}}}}}};
+const rgb_keyboard::keymap_key_table* const rgb_keyboard::ansi_keymap_layout::keymap_offsets = &keymap_offset_table;
 
 // options for keymapping
-const std::map<std::string_view, std::array<uint8_t, 3>> rgb_keyboard::keyboard::keymap_options = {
+constexpr rgb_keyboard::static_table<std::array<uint8_t, 3>, 195> keymap_option_table = {{
     // top row
     {"Esc", {0x02, 0x02, 0x29}},
     {"F1", {0x02, 0x02, 0x3a}},
@@ -353,4 +409,5 @@ const std::map<std::string_view, std::array<uint8_t, 3>> rgb_keyboard::keyboard:
     {"F21", {0x02, 0x02, 0x70}},
     {"F22", {0x02, 0x02, 0x71}},
     {"F23", {0x02, 0x02, 0x72}},
-    {"F24", {0x02, 0x02, 0x73}}};
+    {"F24", {0x02, 0x02, 0x73}}}};
+const rgb_keyboard::static_table<std::array<uint8_t, 3>, 195>& rgb_keyboard::keyboard::keymap_options = keymap_option_table;
@@ -0,0 +1,164 @@
+// supported keyboard models and their protocol differences
+#ifndef RGB_KEYBOARD_DEVICE_MODELS
+#define RGB_KEYBOARD_DEVICE_MODELS
+
+#include <array>
+#include <cstdint>
+#include <tuple>
+
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+#include "packet_program.h"
+#include "static_table.h"
+
+namespace rgb_keyboard {
+
+    /// Transfer policy: data packets are written to interrupt endpoint 3
+    struct interrupt_transfer {
+        /// Endpoint for data packets
+        static constexpr uint8_t endpoint_out = 0x03;
+        /// Endpoint for responses
+        static constexpr uint8_t endpoint_in = 0x82;
+    };
+
+    /// Transfer policy: data packets are written with HID SET_REPORT control transfers
+    struct control_transfer {
+        /// bmRequestType: host to device, class, interface
+        static constexpr uint8_t request_type = 0x21;
+        /// bRequest: SET_REPORT
+        static constexpr uint8_t request = 0x09;
+        /// wValue: output report 4
+        static constexpr uint16_t value = 0x0204;
+        /// wIndex: interface 1
+        static constexpr uint16_t index = 0x0001;
+        /// Endpoint for responses
+        static constexpr uint8_t endpoint_in = 0x82;
+    };
+
+    /// Key name → led packet bytes (checksum, address low, address high)
+    using led_key_table = static_table<std::array<uint8_t, 3>, 105>;
+    /// Key name → positions of the function bytes in the keymap packets ([packet, byte] for each of the 3 bytes)
+    using keymap_key_table = static_table<std::array<std::array<uint8_t, 2>, 3>, 105>;
+
+    /** Led layout of the full size keyboards
+     * Key names and key indices are the same for all led layouts, a layout with fewer keys leaves indices unused.
+     */
+    struct full_size_led_layout {
+        /// Led address of each key name
+        static const led_key_table& keycodes;
+        /// Checksum byte of the custom led packet of each key index
+        static const std::array<uint8_t, max_keys>& led_checksums;
+        /// Key positions
+        static const key_geometry& geometry;
+    };
+
+    /// Keymap layout of the ANSI full size keyboards
+    struct ansi_keymap_layout {
+        /// Keys that can be remapped
+        static const keymap_key_table* const keymap_offsets;
+    };
+
+    /// Keymap layout of keyboards that don't support remapping
+    struct no_keymap_layout {
+        static constexpr const keymap_key_table* keymap_offsets = nullptr;
+    };
+
+    /// Protocol policy of most keyboards (Tecware Phantom, GMMK, ...)
+    struct standard_model {
+        using transfer = interrupt_transfer;
+        using led_layout = full_size_led_layout;
+        using keymap_layout = ansi_keymap_layout;
+        static constexpr const char* name = "standard";
+        static constexpr const char* id = "standard";
+        static constexpr packet_program::models program_model = packet_program::models::standard;
+        static constexpr int brightness_max = 9;
+        static constexpr int speed_max = 3;
+        static constexpr bool read_support = true;
+    };
+
+    /// Protocol policy of the Ajazz AK33
+    struct ajazzak33_model {
+        using transfer = control_transfer;
+        using led_layout = full_size_led_layout;
+        using keymap_layout = no_keymap_layout;
+        static constexpr const char* name = "Ajazz AK33";
+        static constexpr const char* id = "ajazzak33";
+        static constexpr packet_program::models program_model = packet_program::models::ajazzak33;
+        static constexpr int brightness_max = 5;
+        static constexpr int speed_max = 3;
+        static constexpr bool read_support = false;
+    };
+
+    /** All model policies
+     * To add a keyboard with a new protocol, add its policy here and its product ids to device_registry.
+     */
+    using model_policies = std::tuple<standard_model, ajazzak33_model>;
+
+    /// Runtime description of a model policy, selected once when the keyboard is opened
+    struct device_model {
+        /// Name of the model
+        const char* name;
+        /// Short name of the model, used in configuration files
+        const char* id;
+        /// Model stored in packet programs
+        packet_program::models program_model;
+        /// Maximum led brightness
+        int brightness_max;
+        /// Maximum led animation speed
+        int speed_max;
+        /// Checksum byte of the custom led packet of each key index
+        const std::array<uint8_t, max_keys>& led_checksums;
+        /// Key positions of the led layout
+        const key_geometry& geometry;
+        /// Keys that can be remapped, nullptr if remapping is not supported
+        const keymap_key_table* keymap_offsets;
+        /// Can settings be read from the keyboard?
+        bool read_support;
+
+        /// Describe a model policy
+        template <typename policy>
+        static device_model from_policy() {
+            return {policy::name,
+                    policy::id,
+                    policy::program_model,
+                    policy::brightness_max,
+                    policy::speed_max,
+                    policy::led_layout::led_checksums,
+                    policy::led_layout::geometry,
+                    policy::keymap_layout::keymap_offsets,
+                    policy::read_support};
+        }
+    };
+
+    /// The description of each model policy
+    template <typename policy>
+    inline const device_model device_model_of = device_model::from_policy<policy>();
+
+    /// Registry entry: maps a USB product id to a model policy
+    struct device_model_entry {
+        /// USB product id
+        uint16_t pid;
+        /// Model policy
+        const device_model* model;
+        /// Keyboards using this product id
+        const char* keyboards;
+    };
+
+    /// USB vendor id of all supported keyboards
+    constexpr uint16_t keyboard_vid = 0x0c45;
+
+    /** All supported keyboards, opening the keyboard tries each product id in this order.
+     * To add a keyboard with a known protocol, add an entry here.
+     */
+    constexpr std::array<device_model_entry, 6> device_registry = {{
+        {0x652f, &device_model_of<standard_model>, "Tecware Phantom, Glorious GMMK"},
+        {0x7903, &device_model_of<ajazzak33_model>, "Ajazz AK33"},
+        {0x5204, &device_model_of<ajazzak33_model>, "Redragon K550 Yama"},
+        {0x5104, &device_model_of<standard_model>, "Redragon K552 Kumara"},
+        {0x5004, &device_model_of<standard_model>, "Redragon K556 Devarajas"},
+        {0x8520, &device_model_of<standard_model>, "Warrior Kane TC235"},
+    }};
+
+}  // namespace rgb_keyboard
+
+#endif
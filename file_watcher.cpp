@@ -0,0 +1,81 @@
+#include "file_watcher.h"
+
+#include <cstring>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+rgb_keyboard::file_watcher::file_watcher() {
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+rgb_keyboard::file_watcher::~file_watcher() {
+    if (fd >= 0)
+        close(fd);
+}
+
+int rgb_keyboard::file_watcher::add(const std::string& file) {
+    if (fd < 0)
+        return -1;
+
+    // split into directory and file name
+    std::size_t slash = file.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : file.substr(0, slash);
+    std::string name = slash == std::string::npos ? file : file.substr(slash + 1);
+
+    // watch the directory for completed writes and renames
+    int watch = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watch < 0)
+        return -1;
+
+    files.push_back({watch, name});
+    return files.size() - 1;
+}
+
+void rgb_keyboard::file_watcher::read_events(std::vector<bool>& changed) {
+    alignas(inotify_event) char buffer[4096];
+
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char* position = buffer; position < buffer + length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(position);
+            position += sizeof(inotify_event) + event->len;
+
+            if (event->len == 0)
+                continue;
+
+            for (std::size_t i = 0; i < files.size(); i++) {
+                if (files[i].watch == event->wd && files[i].name == event->name)
+                    changed[i] = true;
+            }
+        }
+    }
+}
+
+std::vector<int> rgb_keyboard::file_watcher::wait(std::chrono::milliseconds timeout, std::chrono::milliseconds debounce) {
+    std::vector<bool> changed(files.size(), false);
+    std::vector<int> result;
+    if (fd < 0)
+        return result;
+
+    // wait for the first event
+    pollfd descriptor = {fd, POLLIN, 0};
+    if (poll(&descriptor, 1, timeout.count()) <= 0)
+        return result;
+    read_events(changed);
+
+    // wait until no more events arrive, only if a watched file changed
+    bool any = false;
+    for (bool c : changed)
+        any = any || c;
+    while (any && poll(&descriptor, 1, debounce.count()) > 0)
+        read_events(changed);
+
+    for (std::size_t i = 0; i < changed.size(); i++) {
+        if (changed[i])
+            result.push_back(i);
+    }
+
+    return result;
+}
@@ -0,0 +1,60 @@
+// watch files for changes (inotify)
+#ifndef RGB_KEYBOARD_FILE_WATCHER
+#define RGB_KEYBOARD_FILE_WATCHER
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace rgb_keyboard {
+
+    /**
+     * This class watches files for changes with inotify.
+     *
+     * The directory of each file is watched instead of the file itself, so that files
+     * replaced by editors (written to a temporary file and renamed) are still detected.
+     */
+    class file_watcher {
+     public:
+        file_watcher();
+        ~file_watcher();
+
+        file_watcher(const file_watcher&) = delete;
+        file_watcher& operator=(const file_watcher&) = delete;
+
+        /** Watch a file
+         * \return Id of the file (0, 1, ...), -1 if the file can't be watched
+         */
+        int add(const std::string& file);
+
+        /** Wait for changes
+         *
+         * Returns after the first change, once no further change happened for the debounce time,
+         * so that a burst of writes (e.g. an editor saving a file) is reported once.
+         * \param timeout Maximum time to wait for the first change
+         * \param debounce Time without changes before returning
+         * \return Ids of the changed files, empty after a timeout or if interrupted by a signal
+         */
+        std::vector<int> wait(std::chrono::milliseconds timeout, std::chrono::milliseconds debounce);
+
+     private:
+        /// Read all pending events, mark changed files
+        void read_events(std::vector<bool>& changed);
+
+        /// A watched file
+        struct watched_file {
+            /// inotify watch descriptor of the directory
+            int watch;
+            /// File name inside the directory
+            std::string name;
+        };
+
+        /// inotify file descriptor
+        int fd = -1;
+        /// All watched files, the index is the id
+        std::vector<watched_file> files;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
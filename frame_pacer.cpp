@@ -0,0 +1,142 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <time.h>
+
+namespace {
+    using rgb_keyboard::frame_pacer;
+
+    // bucket of a duration in microseconds: 1 µs buckets below sub_buckets, then sub_buckets buckets per power of 2
+    int bucket_index(int64_t microseconds) {
+        constexpr int sub_buckets = frame_pacer::histogram::sub_buckets;
+        if (microseconds < sub_buckets)
+            return std::max<int64_t>(microseconds, 0);
+        const int exponent = 63 - __builtin_clzll(microseconds);
+        const int sub = (microseconds >> (exponent - 6)) & (sub_buckets - 1);
+        return std::min((exponent - 5) * sub_buckets + sub, frame_pacer::histogram::bucket_count - 1);
+    }
+
+    // sleep until an absolute time of steady_clock, which is CLOCK_MONOTONIC on Linux
+    void sleep_until(frame_pacer::clock::time_point time) {
+        auto since_epoch = std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        if (since_epoch < 0)
+            return;
+        timespec deadline{static_cast<time_t>(since_epoch / 1000000000), static_cast<long>(since_epoch % 1000000000)};
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {
+        }
+    }
+}  // namespace
+
+void rgb_keyboard::frame_pacer::histogram::add(clock::duration value) {
+    counts[bucket_index(std::chrono::duration_cast<std::chrono::microseconds>(value).count())]++;
+    total_count++;
+    sum += value;
+    minimum = std::min(minimum, value);
+    maximum = std::max(maximum, value);
+}
+
+rgb_keyboard::frame_pacer::clock::duration rgb_keyboard::frame_pacer::histogram::mean() const {
+    return total_count != 0 ? sum / static_cast<clock::rep>(total_count) : clock::duration::zero();
+}
+
+rgb_keyboard::frame_pacer::clock::duration rgb_keyboard::frame_pacer::histogram::bucket_begin(int bucket) {
+    if (bucket < sub_buckets)
+        return std::chrono::microseconds(bucket);
+    const int exponent = bucket / sub_buckets + 5;
+    return std::chrono::microseconds(static_cast<int64_t>(sub_buckets + bucket % sub_buckets) << (exponent - 6));
+}
+
+rgb_keyboard::frame_pacer::clock::duration rgb_keyboard::frame_pacer::histogram::percentile(double p) const {
+    if (total_count == 0)
+        return clock::duration::zero();
+
+    // the durations of a bucket are assumed to be spread evenly over it, the last bucket has no upper edge
+    const double rank = std::clamp(p, 0.0, 1.0) * total_count;
+    std::size_t seen = 0;
+    for (int bucket = 0; bucket < bucket_count - 1; bucket++) {
+        if (counts[bucket] == 0 || seen + counts[bucket] < rank) {
+            seen += counts[bucket];
+            continue;
+        }
+        const auto begin = bucket_begin(bucket);
+        const auto width = bucket_begin(bucket + 1) - begin;
+        const auto value = begin + std::chrono::duration_cast<clock::duration>(width * ((rank - seen) / counts[bucket]));
+        return std::clamp(value, minimum, maximum);
+    }
+    return maximum;
+}
+
+double rgb_keyboard::frame_pacer::statistics::fps() const {
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? frames / seconds : 0;
+}
+
+double rgb_keyboard::frame_pacer::statistics::sustainable_fps() const {
+    auto busy = std::chrono::duration<double>(render.percentile(0.9) + transfer.percentile(0.9)).count();
+    return frames != 0 && busy > 0 ? 1 / busy : 0;
+}
+
+rgb_keyboard::frame_pacer::frame_pacer(int fps) {
+    set_fps(fps);
+}
+
+void rgb_keyboard::frame_pacer::set_fps(int fps) {
+    period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / std::max(fps, 1)));
+}
+
+rgb_keyboard::frame_pacer::clock::time_point rgb_keyboard::frame_pacer::wait() {
+    const auto now = clock::now();
+    if (start == clock::time_point()) {
+        start = deadline = frame_start = now;
+        return deadline;
+    }
+
+    // skip deadlines that have passed while the last frame was rendered and sent
+    deadline += period;
+    if (now > deadline) {
+        auto missed = (now - deadline) / period + 1;
+        stats.skipped += missed;
+        deadline += missed * period;
+    }
+    sleep_until(deadline);
+
+    const auto wake = clock::now();
+    stats.interval.add(wake - frame_start);
+    stats.lateness.add(wake - deadline);
+    frame_start = wake;
+    return deadline;
+}
+
+bool rgb_keyboard::frame_pacer::wait_until(clock::time_point time, const volatile std::sig_atomic_t& stop) {
+    // sleep in steps so a stop request ends long pauses between frames
+    constexpr auto step = std::chrono::milliseconds(100);
+    while (!stop && clock::now() + step < time)
+        sleep_until(clock::now() + step);
+    if (stop)
+        return false;
+    sleep_until(time);
+
+    const auto wake = clock::now();
+    if (start == clock::time_point())
+        start = wake;
+    else
+        stats.interval.add(wake - frame_start);
+    stats.lateness.add(wake - time);
+    frame_start = wake;
+    deadline = time;
+    return true;
+}
+
+void rgb_keyboard::frame_pacer::rendered() {
+    render_end = clock::now();
+    stats.render.add(render_end - frame_start);
+}
+
+void rgb_keyboard::frame_pacer::sent() {
+    const auto now = clock::now();
+    stats.transfer.add(now - render_end);
+    stats.frames++;
+    stats.elapsed = now - start;
+}
@@ -0,0 +1,132 @@
+// frame timing for host side animations
+#ifndef RGB_KEYBOARD_FRAME_PACER
+#define RGB_KEYBOARD_FRAME_PACER
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+
+namespace rgb_keyboard {
+
+    /**
+     * This class schedules frames at absolute deadlines and measures their timing.
+     *
+     * Frame n is due at start + n * period. wait() sleeps with clock_nanosleep(TIMER_ABSTIME),
+     * so time spent rendering and sending doesn't shift later frames. A frame that misses its
+     * deadline makes the pacer skip to the next deadline that is still ahead instead of
+     * accumulating lag. Frame intervals, wake up lateness, render time and USB time are
+     * recorded in histograms.
+     */
+    class frame_pacer {
+     public:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * Histogram of durations.
+         *
+         * Buckets are 1 µs wide below 64 µs, above that every power of 2 microseconds is split
+         * into 64 buckets (HDR histogram style), up to over a minute. Percentiles are interpolated
+         * within their bucket, so they are accurate to about 1.6%, the minimum and maximum are exact.
+         */
+        class histogram {
+         public:
+            /// Buckets per power of 2, the linear buckets below 64 µs are 1 µs wide
+            static constexpr int sub_buckets = 64;
+            /// Number of buckets, durations above the last bucket are counted in it
+            static constexpr int bucket_count = 22 * sub_buckets;
+
+            /// Add a duration
+            void add(clock::duration value);
+
+            /// Number of durations
+            [[nodiscard]] std::size_t count() const { return total_count; }
+            /// Mean duration
+            [[nodiscard]] clock::duration mean() const;
+            /// Shortest duration, 0 if there is none
+            [[nodiscard]] clock::duration min() const { return total_count != 0 ? minimum : clock::duration::zero(); }
+            /// Longest duration
+            [[nodiscard]] clock::duration max() const { return maximum; }
+            /** Duration below which a fraction of the durations lie, interpolated within its bucket
+             * \param p Fraction of the durations, 0 - 1
+             */
+            [[nodiscard]] clock::duration percentile(double p) const;
+
+            /// Number of durations in each bucket
+            [[nodiscard]] const std::array<uint32_t, bucket_count>& buckets() const { return counts; }
+            /// Lower edge of a bucket
+            [[nodiscard]] static clock::duration bucket_begin(int bucket);
+
+         private:
+            std::array<uint32_t, bucket_count> counts{};
+            std::size_t total_count = 0;
+            clock::duration sum{};
+            clock::duration minimum = clock::duration::max();
+            clock::duration maximum{};
+        };
+
+        /// Timing of all frames so far
+        struct statistics {
+            /// Number of frames sent
+            std::size_t frames = 0;
+            /// Number of deadlines skipped because a frame took too long
+            std::size_t skipped = 0;
+            /// Time since the first frame
+            clock::duration elapsed{};
+            /// Time between the starts of consecutive frames
+            histogram interval;
+            /// Time from a deadline to the wake up
+            histogram lateness;
+            /// Time from the wake up to rendered()
+            histogram render;
+            /// Time from rendered() to sent()
+            histogram transfer;
+
+            /// Achieved frames per second
+            [[nodiscard]] double fps() const;
+            /// Frame rate the renderer and the keyboard can keep up with 90% of the time, 0 if no frame was sent
+            [[nodiscard]] double sustainable_fps() const;
+        };
+
+        /// Create a pacer, fps must be at least 1
+        explicit frame_pacer(int fps);
+
+        /// Change the frame rate, the next deadline is one new period after the last one
+        void set_fps(int fps);
+
+        /** Sleep until the next deadline
+         * The first call returns immediately and starts the schedule.
+         * \return Time of the deadline, i.e. the time the frame should show
+         */
+        clock::time_point wait();
+        /** Sleep until an absolute time instead of the next period, for frames at irregular times
+         * The first call starts the schedule, the frame rate is not used. A time that has passed returns immediately.
+         * \param stop Returns early when this is set, checked every 100 ms
+         * \return false if stop was set
+         */
+        bool wait_until(clock::time_point time, const volatile std::sig_atomic_t& stop);
+        /// Mark the end of rendering the current frame
+        void rendered();
+        /// Mark the end of sending the current frame
+        void sent();
+
+        /// Get the timing of all frames so far
+        [[nodiscard]] const statistics& get_statistics() const { return stats; }
+
+     private:
+        clock::duration period;
+        /// Deadline of the current frame
+        clock::time_point deadline;
+        /// Start of the first frame, clock::time_point() before the first wait()
+        clock::time_point start;
+        /// Wake up of the current frame
+        clock::time_point frame_start;
+        /// Time of the last rendered()
+        clock::time_point render_end;
+        statistics stats;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
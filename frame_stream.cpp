@@ -0,0 +1,225 @@
+#include "frame_stream.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "input_read.h"
+#include "rgb_keyboard.h"
+
+namespace {
+    // size of the input buffer, larger reads go directly into the frame
+    constexpr std::size_t buffer_size = 64 * 1024;
+}  // namespace
+
+rgb_keyboard::frame_stream::frame_stream(formats format, int width, int height, const key_geometry& geometry, int fd)
+    : format(format), width(width), height(height), geometry(geometry), fd(fd), buffer(buffer_size) {}
+
+rgb_keyboard::frame_stream::formats rgb_keyboard::frame_stream::parse_format(std::string_view name) {
+    if (name == "rgb24")
+        return formats::rgb24;
+    if (name == "ppm")
+        return formats::ppm;
+    throw std::invalid_argument("Unknown frame format: " + std::string(name));
+}
+
+bool rgb_keyboard::frame_stream::fill(const volatile std::sig_atomic_t& stop) {
+    position = 0;
+    end = read_input(fd, buffer.data(), buffer.size(), stop);
+    return end != 0;
+}
+
+bool rgb_keyboard::frame_stream::read_bytes(uint8_t* out, std::size_t size, const volatile std::sig_atomic_t& stop) {
+    while (size > 0) {
+        if (position == end) {
+            // large reads bypass the buffer
+            if (size >= buffer.size()) {
+                std::size_t count = read_input(fd, out, size, stop);
+                if (count == 0)
+                    return false;
+                out += count;
+                size -= count;
+                continue;
+            }
+            if (!fill(stop))
+                return false;
+        }
+
+        std::size_t count = std::min(size, end - position);
+        std::memcpy(out, buffer.data() + position, count);
+        position += count;
+        out += count;
+        size -= count;
+    }
+    return true;
+}
+
+int rgb_keyboard::frame_stream::read_byte(const volatile std::sig_atomic_t& stop) {
+    if (position == end && !fill(stop))
+        return -1;
+    return buffer[position++];
+}
+
+int rgb_keyboard::frame_stream::read_header_number(const volatile std::sig_atomic_t& stop) {
+    int c = read_byte(stop);
+    // whitespace and comments
+    while (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#') {
+        if (c == '#') {
+            while (c != '\n' && c != -1)
+                c = read_byte(stop);
+        }
+        c = read_byte(stop);
+    }
+
+    if (c < '0' || c > '9')
+        throw std::invalid_argument("Invalid PPM header");
+    int number = 0;
+    while (c >= '0' && c <= '9') {
+        number = number * 10 + (c - '0');
+        if (number > 65535)
+            throw std::invalid_argument("Invalid PPM header");
+        c = read_byte(stop);
+    }
+    // a single whitespace character ends the number
+    if (c != ' ' && c != '\t' && c != '\r' && c != '\n')
+        throw std::invalid_argument("Invalid PPM header");
+    return number;
+}
+
+bool rgb_keyboard::frame_stream::read(frame& out, const volatile std::sig_atomic_t& stop) {
+    int maximum = 255;
+    if (format == formats::ppm) {
+        int first = read_byte(stop);
+        // whitespace between frames
+        while (first == ' ' || first == '\t' || first == '\r' || first == '\n')
+            first = read_byte(stop);
+        if (first == -1)
+            return false;
+        if (first != 'P' || read_byte(stop) != '6')
+            throw std::invalid_argument("Invalid PPM header, expected binary PPM (P6)");
+
+        out.width = read_header_number(stop);
+        out.height = read_header_number(stop);
+        maximum = read_header_number(stop);
+        if (out.width == 0 || out.height == 0 || maximum == 0 || maximum > 255)
+            throw std::invalid_argument("Unsupported PPM frame, expected 8 bit colors and a size of at least 1x1");
+    } else {
+        out.width = width;
+        out.height = height;
+    }
+
+    out.pixels.resize(static_cast<std::size_t>(out.width) * out.height * 3);
+    if (!read_bytes(out.pixels.data(), out.pixels.size(), stop))
+        return false;
+
+    // scale to 0-255
+    if (maximum != 255) {
+        for (auto& value : out.pixels)
+            value = std::min(value * 255 / maximum, 255);
+    }
+    return true;
+}
+
+void rgb_keyboard::frame_stream::downsample(const frame& image, key_framebuffer& colors) const {
+    const float scale_x = image.width / geometry.width;
+    const float scale_y = image.height / geometry.height;
+    const std::size_t stride = static_cast<std::size_t>(image.width) * 3;
+
+    colors.clear();
+    for (int key = 0; key < max_keys; key++) {
+        if (!geometry.keys.test(key))
+            continue;
+
+        // pixels covered by the key, at least one
+        int left = std::clamp(static_cast<int>(std::floor((geometry.x[key] - geometry.w[key] / 2) * scale_x)), 0, image.width - 1);
+        int right = std::clamp(static_cast<int>(std::ceil((geometry.x[key] + geometry.w[key] / 2) * scale_x)), left + 1, image.width);
+        int top = std::clamp(static_cast<int>(std::floor((geometry.y[key] - geometry.h[key] / 2) * scale_y)), 0, image.height - 1);
+        int bottom = std::clamp(static_cast<int>(std::ceil((geometry.y[key] + geometry.h[key] / 2) * scale_y)), top + 1, image.height);
+
+        uint32_t sum[3] = {0, 0, 0};
+        for (int y = top; y < bottom; y++) {
+            const uint8_t* pixel = image.pixels.data() + y * stride + left * 3;
+            for (int x = left; x < right; x++, pixel += 3) {
+                sum[0] += pixel[0];
+                sum[1] += pixel[1];
+                sum[2] += pixel[2];
+            }
+        }
+
+        const uint32_t area = (right - left) * (bottom - top);
+        colors.set(key, {uint8_t((sum[0] + area / 2) / area), uint8_t((sum[1] + area / 2) / area), uint8_t((sum[2] + area / 2) / area)});
+    }
+}
+
+rgb_keyboard::frame_stream::statistics rgb_keyboard::frame_stream::play(keyboard& kbd, const volatile std::sig_atomic_t& stop) {
+    latest_queue<frame> frames(1);
+    // frames the downsampler is done with, at most one is read, one queued and one downsampled
+    latest_queue<frame> recycled(2);
+    latest_queue<key_framebuffer> patterns(1);
+    std::exception_ptr error;
+    // every counter is written by a single thread
+    statistics reader_stats, downsampler_stats, stats;
+
+    std::thread reader([&] {
+        try {
+            frame image;
+            while (read(image, stop)) {
+                reader_stats.read++;
+                // a dropped frame comes back right away, otherwise reuse one the downsampler is done with
+                if (frames.push(std::move(image), &image) != 0)
+                    reader_stats.dropped++;
+                else
+                    recycled.try_pop(image);
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        frames.close();
+    });
+
+    std::thread downsampler([&] {
+        frame image;
+        key_framebuffer colors, previous;
+        bool first = true;
+        while (frames.pop(image)) {
+            downsample(image, colors);
+            recycled.push(std::move(image));
+            if (!first && colors == previous) {
+                downsampler_stats.unchanged++;
+                continue;
+            }
+            first = false;
+            previous = colors;
+            downsampler_stats.dropped += patterns.push(std::move(colors));
+        }
+        patterns.close();
+    });
+
+    // the first frame switches to the custom mode
+    key_framebuffer colors;
+    bool custom_mode = false;
+    while (patterns.pop(colors)) {
+        kbd.set_custom_pattern(colors);
+        if (custom_mode) {
+            kbd.write_custom();
+        } else {
+            kbd.write_custom_mode();
+            custom_mode = true;
+        }
+        stats.sent++;
+    }
+
+    reader.join();
+    downsampler.join();
+    if (error)
+        std::rethrow_exception(error);
+
+    stats.read = reader_stats.read;
+    stats.dropped = reader_stats.dropped + downsampler_stats.dropped;
+    stats.unchanged = downsampler_stats.unchanged;
+    return stats;
+}
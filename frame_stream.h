@@ -0,0 +1,192 @@
+// raw video frames from a pipe shown on the keys
+#ifndef RGB_KEYBOARD_FRAME_STREAM
+#define RGB_KEYBOARD_FRAME_STREAM
+
+#include <condition_variable>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * A queue between two threads that holds at most capacity elements.
+     *
+     * push() never blocks, if the queue is full the oldest element is dropped, so a slow
+     * consumer always gets the newest elements instead of falling behind.
+     */
+    template <typename T>
+    class latest_queue {
+     public:
+        explicit latest_queue(std::size_t capacity) : capacity(capacity) {}
+
+        /** Add an element, drops the oldest element if the queue is full
+         * \param dropped Receives the dropped element so that its buffers can be reused, may be &value
+         * \return 1 if an element was dropped, 0 otherwise
+         */
+        int push(T&& value, T* dropped = nullptr) {
+            int result = 0;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                elements.push_back(std::move(value));
+                if (elements.size() > capacity) {
+                    if (dropped != nullptr)
+                        *dropped = std::move(elements.front());
+                    elements.pop_front();
+                    result = 1;
+                }
+            }
+            available.notify_one();
+            return result;
+        }
+
+        /** Take the oldest element if there is one, doesn't wait
+         * \return false if the queue is empty, value is unchanged then
+         */
+        bool try_pop(T& value) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (elements.empty())
+                return false;
+            value = std::move(elements.front());
+            elements.pop_front();
+            return true;
+        }
+
+        /** Take the oldest element, waits until one is available
+         * \return false if the queue was closed and is empty
+         */
+        bool pop(T& value) {
+            std::unique_lock<std::mutex> lock(mutex);
+            available.wait(lock, [this] { return !elements.empty() || closed; });
+            if (elements.empty())
+                return false;
+            value = std::move(elements.front());
+            elements.pop_front();
+            return true;
+        }
+
+        /// No more elements are pushed, wakes up pop()
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            available.notify_all();
+        }
+
+     private:
+        std::size_t capacity;
+        std::mutex mutex;
+        std::condition_variable available;
+        std::deque<T> elements;
+        bool closed = false;
+    };
+
+    /**
+     * This class shows a stream of raw RGB frames (e.g. from ffmpeg) on the keys.
+     *
+     * Reading, downsampling and sending run in separate threads connected by queues that hold
+     * a single frame. If a stage is slower than the one before it, stale frames are dropped.
+     * Downsampled and dropped frames go back to the reader, which reads into their pixel buffers.
+     * Each key gets the average color of the area of the image it covers, the image is
+     * stretched over the whole keyboard. Only frames that change a key are sent, and
+     * write_custom() only sends the changed keys.
+     */
+    class frame_stream {
+     public:
+        /// Format of the frames
+        enum class formats {
+            /// width * height * 3 bytes, red, green, blue, row by row
+            rgb24,
+            /// Binary PPM (P6), every frame has its own header
+            ppm
+        };
+
+        /// A frame read from the input
+        struct frame {
+            int width = 0;
+            int height = 0;
+            /// red, green, blue for each pixel, row by row
+            std::vector<uint8_t> pixels;
+        };
+
+        /// Counters of play()
+        struct statistics {
+            /// Frames read from the input
+            std::size_t read = 0;
+            /// Frames dropped because downsampling or sending was too slow
+            std::size_t dropped = 0;
+            /// Frames that didn't change any key
+            std::size_t unchanged = 0;
+            /// Frames sent to the keyboard
+            std::size_t sent = 0;
+        };
+
+        /** Create a frame stream
+         * \param format Format of the frames
+         * \param width, height Size of rgb24 frames, ignored for ppm
+         * \param geometry Key positions of the keyboard
+         * \param fd File descriptor the frames are read from
+         */
+        frame_stream(formats format, int width, int height, const key_geometry& geometry, int fd = 0);
+
+        /** Parse a format name
+         * \throws std::invalid_argument if the name is neither rgb24 nor ppm
+         */
+        static formats parse_format(std::string_view name);
+
+        /** Read the next frame
+         * \param out Receives the frame, the pixel buffer is reused
+         * \param stop Returns early (false) when this is set
+         * \return false at the end of the input
+         * \throws std::invalid_argument if a ppm header is invalid
+         */
+        bool read(frame& out, const volatile std::sig_atomic_t& stop);
+
+        /** Average the colors of the image over the area of each key
+         * \param image The frame, stretched over the whole keyboard
+         * \param colors Receives the colors of all keys of the geometry
+         */
+        void downsample(const frame& image, key_framebuffer& colors) const;
+
+        /** Switch the keyboard to the custom led mode and show frames until the input ends
+         * \param kbd The opened keyboard, frames are sent to its current profile
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \throws std::invalid_argument if the input isn't in the expected format
+         */
+        statistics play(keyboard& kbd, const volatile std::sig_atomic_t& stop);
+
+     private:
+        /// Read exactly size bytes, false at the end of the input or if stop is set
+        bool read_bytes(uint8_t* out, std::size_t size, const volatile std::sig_atomic_t& stop);
+        /// Read a decimal number of a ppm header, skips whitespace and comments before it
+        int read_header_number(const volatile std::sig_atomic_t& stop);
+        /// Read a single byte, -1 at the end of the input
+        int read_byte(const volatile std::sig_atomic_t& stop);
+        /// Refill the input buffer, false at the end of the input or if stop is set
+        bool fill(const volatile std::sig_atomic_t& stop);
+
+        formats format;
+        int width;
+        int height;
+        const key_geometry& geometry;
+        int fd;
+
+        /// Input buffer, bytes between position and end are unread
+        std::vector<uint8_t> buffer;
+        std::size_t position = 0;
+        std::size_t end = 0;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
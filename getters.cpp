@@ -1,5 +1,7 @@
 #include "rgb_keyboard.h"
 
+#include "keymap_parser.h"
+
 int rgb_keyboard::keyboard::get_speed() const {
     return speed[profile - 1];
 }
@@ -57,5 +59,62 @@ int rgb_keyboard::keyboard::get_profile() const {
 }
 
 bool rgb_keyboard::keyboard::get_ajazzak33_compatibility() const {
-    return ajazzak33Compatibility;
+    return model == &device_model_of<ajazzak33_model>;
+}
+
+const rgb_keyboard::device_model& rgb_keyboard::keyboard::get_device_model() const {
+    return *model;
+}
+
+int rgb_keyboard::keyboard::get_led_key_index(std::string_view name) {
+    // key indices are the same for all led layouts
+    const auto* element = full_size_led_layout::keycodes.find(name);
+    if (element == nullptr)
+        return -1;
+
+    // the key index is the led address divided by 3
+    return ((*element)[1] | ((*element)[2] << 8)) / 3;
+}
+
+bool rgb_keyboard::keyboard::get_keymap_key_valid(std::string_view name) {
+    return ansi_keymap_layout::keymap_offsets->contains(name);
+}
+
+bool rgb_keyboard::keyboard::get_keymap_option_valid(std::string_view name) {
+    int macro = macro_number(name);
+    return keymap_options.contains(name) || (macro >= 1 && macro <= max_macros);
+}
+
+const rgb_keyboard::key_geometry& rgb_keyboard::keyboard::get_key_geometry() const {
+    return model->geometry;
+}
+
+const rgb_keyboard::key_framebuffer& rgb_keyboard::keyboard::get_custom_colors() const {
+    return key_colors[profile - 1];
+}
+
+bool rgb_keyboard::keyboard::get_overlays_active() const {
+    return !overlays[profile - 1].empty();
+}
+
+rgb_keyboard::overlay_stack::clock::time_point rgb_keyboard::keyboard::get_next_overlay_change() const {
+    return overlays[profile - 1].next_change();
+}
+
+const rgb_keyboard::color_calibration& rgb_keyboard::keyboard::get_calibration() const {
+    return calibration;
+}
+
+const std::string& rgb_keyboard::keyboard::get_serial() const {
+    return serial;
+}
+
+std::chrono::nanoseconds rgb_keyboard::keyboard::get_packet_time() const {
+    return packet_time;
+}
+
+double rgb_keyboard::keyboard::get_sustainable_fps(std::size_t keys) const {
+    // a custom pattern update is a start packet, one packet per key and an end packet
+    auto frame_time = std::chrono::duration<double>(packet_time * static_cast<int64_t>(keys + 2)).count();
+    return frame_time > 0 ? 1 / frame_time : 0;
 }
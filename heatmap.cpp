@@ -0,0 +1,233 @@
+#include "heatmap.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "key_events.h"
+#include "rgb_keyboard.h"
+
+namespace {
+    // size of a counter file
+    constexpr std::size_t file_length = sizeof(rgb_keyboard::typing_heatmap::file_header) + rgb_keyboard::max_keys * (sizeof(uint64_t) + sizeof(float));
+
+    // nanoseconds since the Unix epoch, the heat time has to survive restarts
+    int64_t wall_time() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    // holds an exclusive flock() of a file, other processes counting into the same file wait
+    class file_lock {
+     public:
+        explicit file_lock(int fd) : fd(fd) {
+            while (flock(fd, LOCK_EX) != 0 && errno == EINTR) {
+            }
+        }
+        ~file_lock() { flock(fd, LOCK_UN); }
+        file_lock(const file_lock&) = delete;
+        file_lock& operator=(const file_lock&) = delete;
+
+     private:
+        int fd;
+    };
+}  // namespace
+
+rgb_keyboard::typing_heatmap::typing_heatmap(const key_geometry& geometry, const std::vector<color>& palette, std::chrono::milliseconds half_life, int levels)
+    : geometry(geometry), half_life(half_life), levels(std::clamp(levels, 2, 256)) {
+    this->palette = animation::make_palette(
+        palette.empty() ? std::vector<color>{{0x00, 0x00, 0x00}, {0x00, 0x00, 0xff}, {0x00, 0xff, 0xff}, {0x00, 0xff, 0x00}, {0xff, 0xff, 0x00}, {0xff, 0x00, 0x00}}
+                        : palette);
+    shown.fill(-1);
+}
+
+rgb_keyboard::typing_heatmap::~typing_heatmap() {
+    unmap();
+}
+
+void rgb_keyboard::typing_heatmap::unmap() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_length);
+    }
+    if (fd >= 0) {
+        close(fd);
+    }
+
+    mapping = nullptr;
+    mapping_length = 0;
+    fd = -1;
+    header = nullptr;
+    counts = nullptr;
+    heat = nullptr;
+}
+
+int rgb_keyboard::typing_heatmap::open(const std::string& file) {
+    unmap();
+
+    // open or create file, it stays open for the lock
+    int file_fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (file_fd < 0) {
+        return 1;
+    }
+
+    void* map = MAP_FAILED;
+    {
+        // the process that creates the file initializes it before others use it
+        file_lock lock(file_fd);
+
+        struct stat file_stat;
+        if (fstat(file_fd, &file_stat) == 0) {
+            const bool created = file_stat.st_size == 0;
+            if ((created && ftruncate(file_fd, file_length) == 0) || (!created && static_cast<std::size_t>(file_stat.st_size) >= file_length)) {
+                // map file shared, changes go to the file
+                map = mmap(nullptr, file_length, PROT_READ | PROT_WRITE, MAP_SHARED, file_fd, 0);
+            }
+            if (map != MAP_FAILED && created) {
+                // a new file is filled with zeros
+                auto* loaded = static_cast<file_header*>(map);
+                std::memcpy(loaded->magic, "RGBKHEAT", sizeof(loaded->magic));
+                loaded->version = format_version;
+                loaded->header_size = sizeof(file_header);
+                loaded->key_count = max_keys;
+                loaded->heat_time = wall_time();
+            }
+        }
+    }
+    if (map == MAP_FAILED) {
+        close(file_fd);
+        return 1;
+    }
+
+    auto* loaded = static_cast<file_header*>(map);
+    if (std::memcmp(loaded->magic, "RGBKHEAT", sizeof(loaded->magic)) != 0 || loaded->version != format_version ||
+        loaded->header_size != sizeof(file_header) || loaded->key_count != static_cast<uint32_t>(max_keys)) {
+        munmap(map, file_length);
+        close(file_fd);
+        return 1;
+    }
+
+    mapping = static_cast<uint8_t*>(map);
+    mapping_length = file_length;
+    fd = file_fd;
+    header = loaded;
+    counts = reinterpret_cast<uint64_t*>(mapping + sizeof(file_header));
+    heat = reinterpret_cast<float*>(counts + max_keys);
+    shown.fill(-1);
+
+    return 0;
+}
+
+void rgb_keyboard::typing_heatmap::press(int key) {
+    if (mapping == nullptr || key < 0 || key >= max_keys)
+        return;
+
+    // other processes may count into the same file
+    __atomic_fetch_add(&counts[key], 1, __ATOMIC_RELAXED);
+
+    // heat is stored as of heat_time, a press after it counts as much as it decays until then,
+    // the file is locked so another process can't decay or add in between
+    const file_lock lock(fd);
+    float weight = 1;
+    if (half_life != std::chrono::milliseconds::zero()) {
+        const double elapsed = std::max<int64_t>(wall_time() - header->heat_time, 0) / 1e6;
+        weight = std::exp2(elapsed / half_life.count());
+    }
+    heat[key] += weight;
+}
+
+uint64_t rgb_keyboard::typing_heatmap::count(int key) const {
+    if (mapping == nullptr || key < 0 || key >= max_keys)
+        return 0;
+    return __atomic_load_n(&counts[key], __ATOMIC_RELAXED);
+}
+
+void rgb_keyboard::typing_heatmap::decay() {
+    const int64_t now = wall_time();
+    if (half_life != std::chrono::milliseconds::zero() && now > header->heat_time) {
+        const float factor = std::exp2(-(now - header->heat_time) / 1e6 / half_life.count());
+        for (int key = 0; key < max_keys; key++)
+            heat[key] *= factor;
+    }
+    header->heat_time = now;
+}
+
+std::size_t rgb_keyboard::typing_heatmap::render(key_framebuffer& colors) {
+    std::array<float, max_keys> values{};
+    if (mapping != nullptr) {
+        const file_lock lock(fd);
+        decay();
+        std::copy(heat, heat + max_keys, values.begin());
+    }
+
+    // logarithmic scale relative to the hottest key, frequent keys would hide all others otherwise
+    float hottest = 0;
+    for (int key = 0; key < max_keys; key++) {
+        if (geometry.keys.test(key))
+            hottest = std::max(hottest, values[key]);
+    }
+    const float scale = hottest > 0 ? (levels - 1) / std::log1p(hottest) : 0;
+
+    // only keys whose level changed get a new color
+    std::size_t changed = 0;
+    for (int key = 0; key < max_keys; key++) {
+        if (!geometry.keys.test(key))
+            continue;
+        const int level = std::clamp(static_cast<int>(std::log1p(std::max(values[key], 0.0f)) * scale + 0.5f), 0, levels - 1);
+        if (level == shown[key])
+            continue;
+        shown[key] = level;
+        const int index = level * 255 / (levels - 1);
+        colors.set(key, color{palette[0][index], palette[1][index], palette[2][index]});
+        changed++;
+    }
+    return changed;
+}
+
+rgb_keyboard::typing_heatmap::statistics rgb_keyboard::typing_heatmap::play(keyboard& kbd, int fd, int fps, const volatile std::sig_atomic_t& stop) {
+    using clock = key_event_reader::clock;
+    statistics stats;
+    key_framebuffer frame;
+
+    // all keys, then switch to the custom mode
+    render(frame);
+    kbd.set_custom_pattern(frame);
+    kbd.write_custom_mode();
+
+    key_event_reader reader(fd);
+    std::vector<key_event_reader::key_press> presses;
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / std::max(fps, 1)));
+    auto next_render = clock::now() + period;
+
+    while (!stop) {
+        // count presses as they arrive, wake up regularly to check for signals
+        reader.wait(std::min(next_render, clock::now() + std::chrono::milliseconds(100)));
+        presses.clear();
+        reader.read(presses);
+        for (const auto& p : presses)
+            press(p.key);
+        stats.presses += presses.size();
+
+        const auto now = clock::now();
+        if (now >= next_render || reader.ended()) {
+            stats.renders++;
+            if (const std::size_t changed = render(frame); changed != 0) {
+                kbd.set_custom_pattern(frame);
+                kbd.write_custom();
+                stats.uploads++;
+                stats.keys += changed;
+            }
+            next_render = std::max(next_render + period, now);
+        }
+
+        if (reader.ended())
+            break;
+    }
+
+    return stats;
+}
@@ -0,0 +1,140 @@
+// typing heatmap with persistent key press counters
+#ifndef RGB_KEYBOARD_HEATMAP
+#define RGB_KEYBOARD_HEATMAP
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "animation.h"
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * This class counts key presses in a memory-mapped file and shows them as a heatmap.
+     *
+     * The file is mapped shared and read-write, the counters are incremented atomically in the
+     * mapping and the kernel writes them back, so they survive restarts without any writes by
+     * the program. Besides the total count each key has a heat value that is halved every half
+     * life, so the heatmap shows recent typing. The heat values and their time are updated
+     * while holding a flock() of the file, so several processes can count into the same file.
+     *
+     * The heat of each key is mapped to one of levels colors of a palette, relative to the hottest
+     * key on a logarithmic scale. Only keys whose level changed get a new color, updates without a
+     * changed level send nothing.
+     *
+     * File layout (little endian):
+     * - 64 byte header (see file_header)
+     * - max_keys uint64_t press counts, indexed by the key index
+     * - max_keys float heat values, indexed by the key index
+     */
+    class typing_heatmap {
+     public:
+        /// Current file format version
+        static constexpr uint16_t format_version = 1;
+
+        /// The file header
+        struct file_header {
+            /// Always "RGBKHEAT"
+            char magic[8];
+            /// File format version
+            uint16_t version;
+            /// Size of this header in bytes
+            uint16_t header_size;
+            /// Number of keys, max_keys
+            uint32_t key_count;
+            /// Time the heat values were last decayed, nanoseconds since the Unix epoch
+            int64_t heat_time;
+            /// Reserved, always 0
+            uint8_t reserved[40];
+        };
+        static_assert(sizeof(file_header) == 64, "header must be 64 bytes long");
+
+        /// Counters of play()
+        struct statistics {
+            /// Key presses counted
+            std::size_t presses = 0;
+            /// Heatmaps rendered
+            std::size_t renders = 0;
+            /// Renders with a changed level, i.e. write_custom() calls sending colors
+            std::size_t uploads = 0;
+            /// Keys whose color was changed
+            std::size_t keys = 0;
+        };
+
+        /** Create a heatmap
+         * \param geometry Key positions of the keyboard
+         * \param palette Colors from cold to hot (evenly spaced), empty for the default palette
+         * \param half_life Time after which the heat of a key is halved, 0 to never decay
+         * \param levels Number of colors the heat is quantized to, 2 - 256
+         */
+        typing_heatmap(const key_geometry& geometry, const std::vector<color>& palette = {}, std::chrono::milliseconds half_life = {}, int levels = 16);
+        ~typing_heatmap();
+        typing_heatmap(const typing_heatmap&) = delete;
+        typing_heatmap& operator=(const typing_heatmap&) = delete;
+
+        /** Map a counter file, it is created if it doesn't exist
+         * \return 0 if successful, 1 if the file could not be opened or is not a heatmap file
+         */
+        int open(const std::string& file);
+
+        /// Count a key press
+        void press(int key);
+        /// Number of presses of a key since the file was created
+        [[nodiscard]] uint64_t count(int key) const;
+
+        /** Update the colors of keys whose heat level changed
+         * \param colors Colors of the keys, only changed keys are set, all keys of the geometry on the first call
+         * \return Number of keys whose color was set
+         */
+        std::size_t render(key_framebuffer& colors);
+
+        /** Switch the keyboard to the custom led mode, count the key presses read from a file descriptor and show the heatmap
+         * The descriptor is an evdev device, a pipe or a regular file containing input_event records, see key_event_reader.
+         * \param kbd The opened keyboard, the heatmap is sent to its current profile
+         * \param fd File descriptor to read input_event records from
+         * \param fps Heatmap updates per second
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \return Counters, after the end of the input or when stop is set
+         */
+        statistics play(keyboard& kbd, int fd, int fps, const volatile std::sig_atomic_t& stop);
+
+     private:
+        /// Unmap and close the file
+        void unmap();
+        /// Halve the heat values for the time since heat_time
+        void decay();
+
+        /// Key positions
+        const key_geometry& geometry;
+        /// Palette lookup tables
+        animation::palette_table palette;
+        /// Heat half life, 0 to never decay
+        std::chrono::milliseconds half_life;
+        /// Number of colors
+        int levels;
+
+        /// The mapped file, nullptr if no file is mapped
+        uint8_t* mapping = nullptr;
+        std::size_t mapping_length = 0;
+        /// The open file, locked while the heat values are updated, -1 if no file is mapped
+        int fd = -1;
+        file_header* header = nullptr;
+        uint64_t* counts = nullptr;
+        float* heat = nullptr;
+
+        /// Level of each key shown by the last render(), -1 before the first one
+        std::array<int16_t, max_keys> shown;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -10,12 +10,19 @@ int rgb_keyboard::keyboard::open_keyboard() {
         return res;
     }
 
+    // nothing is known about the custom colors of the keyboard
+    invalidate_custom();
+
     // open device, try to open keyboard with each pid
-    for (auto pid : keyboard_pid) {
-        handle = libusb_open_device_with_vid_pid(nullptr, keyboard_vid, pid);
+    for (const auto& entry : device_registry) {
+        handle = libusb_open_device_with_vid_pid(nullptr, keyboard_vid, entry.pid);
 
-        if (handle)
+        if (handle) {
+            // select model by pid
+            if (!model_forced)
+                select_model(*entry.model);
             break;
+        }
     }
 
     if (!handle) {  // no device opened
@@ -23,6 +30,8 @@ int rgb_keyboard::keyboard::open_keyboard() {
         return res;
     }
 
+    read_serial();
+
     if (detach_kernel_driver) {
         if (open_interface_0) {
             // detach kernel driver on interface 0 if active
@@ -72,6 +81,9 @@ int rgb_keyboard::keyboard::open_keyboard_bus_device(uint8_t bus, uint8_t device
         return res;
     }
 
+    // nothing is known about the custom colors of the keyboard
+    invalidate_custom();
+
     // open device (_handle)
 
     libusb_device** dev_list;                                       // device list
@@ -86,15 +98,29 @@ int rgb_keyboard::keyboard::open_keyboard_bus_device(uint8_t bus, uint8_t device
             // open device
             if (libusb_open(dev_list[i], &handle) != 0) {
                 return 1;
-            } else {
-                break;
             }
+
+            // select model by pid, unknown keyboards use the standard model
+            libusb_device_descriptor descriptor;
+            if (!model_forced && libusb_get_device_descriptor(dev_list[i], &descriptor) == 0) {
+                select_model(device_model_of<standard_model>);
+                for (const auto& entry : device_registry) {
+                    if (entry.pid == descriptor.idProduct)
+                        select_model(*entry.model);
+                }
+            }
+            break;
         }
     }
 
     // free device list, unreference devices
     libusb_free_device_list(dev_list, 1);
 
+    if (!handle)  // no device opened
+        return 1;
+
+    read_serial();
+
     if (detach_kernel_driver) {
         if (open_interface_0) {
             // detach kernel driver on interface 0 if active
@@ -136,8 +162,48 @@ int rgb_keyboard::keyboard::open_keyboard_bus_device(uint8_t bus, uint8_t device
     return res;
 }
 
+// read the serial number string descriptor, used to select the color calibration
+void rgb_keyboard::keyboard::read_serial() {
+    serial.clear();
+
+    libusb_device_descriptor descriptor;
+    if (libusb_get_device_descriptor(libusb_get_device(handle), &descriptor) != 0 || descriptor.iSerialNumber == 0)
+        return;
+
+    unsigned char buffer[256];
+    int length = libusb_get_string_descriptor_ascii(handle, descriptor.iSerialNumber, buffer, sizeof(buffer));
+    if (length > 0)
+        serial.assign(reinterpret_cast<const char*>(buffer), length);
+}
+
+// open simulated keyboard that records to a pcapng file
+int rgb_keyboard::keyboard::open_dry_run(const std::string& file, uint8_t bus, uint8_t device) {
+    invalidate_custom();
+
+    dry_run = std::make_shared<pcapng_writer>();
+    if (dry_run->open(file, bus, device) != 0) {
+        dry_run.reset();
+        return 1;
+    }
+
+    update_transport();
+    return 0;
+}
+
 // close keyboard
 int rgb_keyboard::keyboard::close_keyboard() {
+    // close dry run capture
+    if (dry_run) {
+        dry_run->close();
+        dry_run.reset();
+        update_transport();
+        return 0;
+    }
+
+    // nothing to do if no keyboard was opened (e.g. when only capturing)
+    if (!handle)
+        return 0;
+
     // release interface 0 and 1
     if (open_interface_0) {
         libusb_release_interface(handle, 0);
@@ -160,21 +226,146 @@ int rgb_keyboard::keyboard::close_keyboard() {
     return 0;
 }
 
-// send data
+// start storing packets instead of sending them
+void rgb_keyboard::keyboard::begin_capture() {
+    // the program may be sent to a keyboard in any state, write_custom() has to send all keys
+    invalidate_custom();
+
+    capture = true;
+    captured_packets.clear();
+    update_transport();
+}
+
+// stop capturing, return stored packets
+std::vector<rgb_keyboard::packet> rgb_keyboard::keyboard::end_capture() {
+    // the captured packets have not been sent
+    invalidate_custom();
+
+    capture = false;
+    update_transport();
+    return std::move(captured_packets);
+}
+
+// forget custom colors of all profiles
+void rgb_keyboard::keyboard::invalidate_custom() {
+    key_colors_shadow_valid.fill(false);
+}
+
+// send data, the transport has been selected for the model when opening the keyboard
 int rgb_keyboard::keyboard::write_data(const unsigned char* data, int length) {
+    const auto start = std::chrono::steady_clock::now();
+    int result = (this->*transport)(data, length);
+
+    // moving average over about 8 packets
+    const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    packet_time = packet_time.count() == 0 ? duration : packet_time + (duration - packet_time) / 8;
+
+    return result;
+}
+
+// send data with interrupt transfers
+template <>
+int rgb_keyboard::keyboard::write_usb<rgb_keyboard::interrupt_transfer>(const unsigned char* data, int length) {
     int result = 0;       // return value
     int transferred = 0;  // transferred bytes, gets ignored for now
     uint8_t buffer[64];   // buffer to receive data
 
-    if (ajazzak33Compatibility) {
-        // write data packet to endpoint 0
-        result += libusb_control_transfer(handle, 0x21, 0x09, 0x0204, 0x0001, const_cast<unsigned char*>(data), length, 1000);
-        // read from endpoint 2
-        result += libusb_interrupt_transfer(handle, 0x82, buffer, 64, &transferred, 1000);
+    // write data packet to endpoint 3
+    result += libusb_interrupt_transfer(handle, interrupt_transfer::endpoint_out, const_cast<unsigned char*>(data), length, &transferred, 1000);
+    // read from endpoint 2
+    result += libusb_interrupt_transfer(handle, interrupt_transfer::endpoint_in, buffer, 64, &transferred, 1000);
+
+    return result;
+}
+
+// send data with control transfers
+template <>
+int rgb_keyboard::keyboard::write_usb<rgb_keyboard::control_transfer>(const unsigned char* data, int length) {
+    int result = 0;       // return value
+    int transferred = 0;  // transferred bytes, gets ignored for now
+    uint8_t buffer[64];   // buffer to receive data
+
+    // write data packet to endpoint 0, a successful control transfer returns the number of bytes sent, only errors count
+    const int sent = libusb_control_transfer(handle, control_transfer::request_type, control_transfer::request, control_transfer::value,
+                                             control_transfer::index, const_cast<unsigned char*>(data), length, 1000);
+    if (sent < 0)
+        result += sent;
+    // read from endpoint 2
+    result += libusb_interrupt_transfer(handle, control_transfer::endpoint_in, buffer, 64, &transferred, 1000);
+
+    return result;
+}
+
+// record interrupt transfers, the simulated keyboard responds with zeroes
+template <>
+int rgb_keyboard::keyboard::write_dry_run<rgb_keyboard::interrupt_transfer>(const unsigned char* data, int length) {
+    const uint8_t buffer[64] = {};
+    dry_run->record_interrupt(interrupt_transfer::endpoint_out, data, length);
+    dry_run->record_interrupt(interrupt_transfer::endpoint_in, buffer, 64);
+    return 0;
+}
+
+// record control transfers, the simulated keyboard responds with zeroes
+template <>
+int rgb_keyboard::keyboard::write_dry_run<rgb_keyboard::control_transfer>(const unsigned char* data, int length) {
+    const uint8_t buffer[64] = {};
+    dry_run->record_control(control_transfer::request_type, control_transfer::request, control_transfer::value, control_transfer::index, data, length);
+    dry_run->record_interrupt(control_transfer::endpoint_in, buffer, 64);
+    return 0;
+}
+
+// store data instead of sending it
+int rgb_keyboard::keyboard::write_capture(const unsigned char* data, int length) {
+    packet captured{};
+    std::copy(data, data + std::min(length, packet_length), captured.begin());
+    captured_packets.push_back(captured);
+    return 0;
+}
+
+// instantiate the packet path for the transfer method of each model policy
+template <typename... policies>
+std::array<rgb_keyboard::keyboard::model_transports, sizeof...(policies)> rgb_keyboard::keyboard::make_model_table(const std::tuple<policies...>*) {
+    return {{{&device_model_of<policies>, &keyboard::write_usb<typename policies::transfer>, &keyboard::write_dry_run<typename policies::transfer>}...}};
+}
+
+const std::array<rgb_keyboard::keyboard::model_transports, std::tuple_size_v<rgb_keyboard::model_policies>> rgb_keyboard::keyboard::model_table =
+    make_model_table(static_cast<const model_policies*>(nullptr));
+
+void rgb_keyboard::keyboard::select_model(const device_model& selected) {
+    const auto* entry = std::find_if(model_table.begin(), model_table.end(), [&](const model_transports& e) { return e.model == &selected; });
+    if (entry == model_table.end())
+        throw std::invalid_argument(std::string("Unknown keyboard model ") + selected.name);
+
+    model = entry->model;
+    usb_transport = entry->usb;
+    dry_run_transport = entry->dry_run;
+    update_transport();
+}
+
+// choose transport for write_data()
+void rgb_keyboard::keyboard::update_transport() {
+    if (capture)
+        transport = &keyboard::write_capture;
+    else if (dry_run)
+        transport = dry_run_transport;
+    else
+        transport = usb_transport;
+}
+
+// send read request, receive data
+int rgb_keyboard::keyboard::read_data(const unsigned char* data, unsigned char* buffer) {
+    int result = 0;       // return value
+    int transferred = 0;  // transferred bytes, gets ignored for now
+
+    if (dry_run) {
+        // record transfers, the simulated keyboard responds with zeroes
+        std::fill(buffer, buffer + 64, 0);
+        dry_run->record_interrupt(0x03, data, 64);
+        dry_run->record_interrupt(0x82, buffer, 64);
 
     } else {
         // write data packet to endpoint 3
-        result += libusb_interrupt_transfer(handle, 0x03, const_cast<unsigned char*>(data), length, &transferred, 1000);
+        result += libusb_interrupt_transfer(handle, 0x03, const_cast<unsigned char*>(data), 64, &transferred, 1000);
         // read from endpoint 2
         result += libusb_interrupt_transfer(handle, 0x82, buffer, 64, &transferred, 1000);
     }
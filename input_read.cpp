@@ -0,0 +1,28 @@
+#include "input_read.h"
+
+#include <cerrno>
+
+#include <poll.h>
+#include <unistd.h>
+
+namespace {
+    // how often a blocked read checks stop, in milliseconds
+    constexpr int stop_interval = 100;
+}  // namespace
+
+std::size_t rgb_keyboard::read_input(int fd, uint8_t* out, std::size_t size, const volatile std::sig_atomic_t& stop) {
+    while (!stop) {
+        pollfd input{fd, POLLIN, 0};
+        int ready = poll(&input, 1, stop_interval);
+        if (ready < 0 && errno != EINTR)
+            return 0;
+        if (ready <= 0)
+            continue;
+
+        ssize_t count = ::read(fd, out, size);
+        if (count < 0 && errno == EINTR)
+            continue;
+        return count > 0 ? count : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,21 @@
+// reads from pipes and files that can be interrupted by a signal
+#ifndef RGB_KEYBOARD_INPUT_READ
+#define RGB_KEYBOARD_INPUT_READ
+
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+
+namespace rgb_keyboard {
+
+    /** Read up to size bytes from a file descriptor, waits until input is available
+     * poll() wakes up regularly to check stop, so a blocked pipe doesn't keep the program from stopping.
+     * Reads interrupted by a signal are restarted.
+     * \param stop Returns early (0) when this is set
+     * \return Number of bytes read, 0 at the end of the input, on errors or when stop is set
+     */
+    std::size_t read_input(int fd, uint8_t* out, std::size_t size, const volatile std::sig_atomic_t& stop);
+
+}  // namespace rgb_keyboard
+
+#endif
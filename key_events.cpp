@@ -0,0 +1,221 @@
+#include "key_events.h"
+
+#include <algorithm>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rgb_keyboard.h"
+#include "static_table.h"
+
+namespace {
+    using clock = rgb_keyboard::key_event_reader::clock;
+
+    // evdev key codes of the keys with a led, Fn is handled by the keyboard and has no key code
+    constexpr rgb_keyboard::static_table<uint16_t, 104> evdev_code_table = {{
+        {"Esc", KEY_ESC},
+        {"F1", KEY_F1},
+        {"F2", KEY_F2},
+        {"F3", KEY_F3},
+        {"F4", KEY_F4},
+        {"F5", KEY_F5},
+        {"F6", KEY_F6},
+        {"F7", KEY_F7},
+        {"F8", KEY_F8},
+        {"F9", KEY_F9},
+        {"F10", KEY_F10},
+        {"F11", KEY_F11},
+        {"F12", KEY_F12},
+        {"PrtSc", KEY_SYSRQ},
+        {"ScrLk", KEY_SCROLLLOCK},
+        {"Pause", KEY_PAUSE},
+        {"Tilde", KEY_GRAVE},
+        {"1", KEY_1},
+        {"2", KEY_2},
+        {"3", KEY_3},
+        {"4", KEY_4},
+        {"5", KEY_5},
+        {"6", KEY_6},
+        {"7", KEY_7},
+        {"8", KEY_8},
+        {"9", KEY_9},
+        {"0", KEY_0},
+        {"Minus", KEY_MINUS},
+        {"Equals", KEY_EQUAL},
+        {"Backspace", KEY_BACKSPACE},
+        {"Insert", KEY_INSERT},
+        {"Home", KEY_HOME},
+        {"PgUp", KEY_PAGEUP},
+        {"Num_Lock", KEY_NUMLOCK},
+        {"Num_Slash", KEY_KPSLASH},
+        {"Num_Asterisk", KEY_KPASTERISK},
+        {"Num_Minus", KEY_KPMINUS},
+        {"Tab", KEY_TAB},
+        {"q", KEY_Q},
+        {"w", KEY_W},
+        {"e", KEY_E},
+        {"r", KEY_R},
+        {"t", KEY_T},
+        {"y", KEY_Y},
+        {"u", KEY_U},
+        {"i", KEY_I},
+        {"o", KEY_O},
+        {"p", KEY_P},
+        {"Bracket_l", KEY_LEFTBRACE},
+        {"Bracket_r", KEY_RIGHTBRACE},
+        {"Backslash", KEY_BACKSLASH},
+        {"Delete", KEY_DELETE},
+        {"End", KEY_END},
+        {"PgDn", KEY_PAGEDOWN},
+        {"Num_7", KEY_KP7},
+        {"Num_8", KEY_KP8},
+        {"Num_9", KEY_KP9},
+        {"Num_Plus", KEY_KPPLUS},
+        {"Caps_Lock", KEY_CAPSLOCK},
+        {"a", KEY_A},
+        {"s", KEY_S},
+        {"d", KEY_D},
+        {"f", KEY_F},
+        {"g", KEY_G},
+        {"h", KEY_H},
+        {"j", KEY_J},
+        {"k", KEY_K},
+        {"l", KEY_L},
+        {"Semicolon", KEY_SEMICOLON},
+        {"Apostrophe", KEY_APOSTROPHE},
+        {"Return", KEY_ENTER},
+        {"Num_4", KEY_KP4},
+        {"Num_5", KEY_KP5},
+        {"Num_6", KEY_KP6},
+        {"Shift_l", KEY_LEFTSHIFT},
+        {"z", KEY_Z},
+        {"x", KEY_X},
+        {"c", KEY_C},
+        {"v", KEY_V},
+        {"b", KEY_B},
+        {"n", KEY_N},
+        {"m", KEY_M},
+        {"Comma", KEY_COMMA},
+        {"Period", KEY_DOT},
+        {"Slash", KEY_SLASH},
+        {"Shift_r", KEY_RIGHTSHIFT},
+        {"Up", KEY_UP},
+        {"Num_1", KEY_KP1},
+        {"Num_2", KEY_KP2},
+        {"Num_3", KEY_KP3},
+        {"Num_Return", KEY_KPENTER},
+        {"Ctrl_l", KEY_LEFTCTRL},
+        {"Super_l", KEY_LEFTMETA},
+        {"Alt_l", KEY_LEFTALT},
+        {"Space", KEY_SPACE},
+        {"Alt_r", KEY_RIGHTALT},
+        {"Menu", KEY_COMPOSE},
+        {"Ctrl_r", KEY_RIGHTCTRL},
+        {"Left", KEY_LEFT},
+        {"Down", KEY_DOWN},
+        {"Right", KEY_RIGHT},
+        {"Num_0", KEY_KP0},
+        {"Num_Period", KEY_KPDOT},
+        {"Int_Key", KEY_102ND},
+    }};
+
+    // time stamp of an event
+    clock::time_point event_time(const input_event& event) {
+        return clock::time_point(std::chrono::duration_cast<clock::duration>(std::chrono::seconds(event.input_event_sec) +
+                                                                             std::chrono::microseconds(event.input_event_usec)));
+    }
+}  // namespace
+
+int rgb_keyboard::key_event_reader::key_index(unsigned int code) {
+    // evdev key code to key index, built once
+    static const std::array<int16_t, KEY_CNT> indices = [] {
+        std::array<int16_t, KEY_CNT> result;
+        result.fill(-1);
+        for (const auto& entry : evdev_code_table)
+            result[entry.second] = keyboard::get_led_key_index(entry.first);
+        return result;
+    }();
+
+    return code < indices.size() ? indices[code] : -1;
+}
+
+rgb_keyboard::key_event_reader::key_event_reader(int fd) : fd(fd) {
+    // devices get monotonic time stamps, the clock of steady_clock
+    struct stat file_stat {};
+    fstat(fd, &file_stat);
+    if (S_ISREG(file_stat.st_mode)) {
+        source = sources::recording;
+    } else if (S_ISCHR(file_stat.st_mode)) {
+        int clock_id = CLOCK_MONOTONIC;
+        if (ioctl(fd, EVIOCSCLOCKID, &clock_id) == 0)
+            source = sources::device;
+    }
+
+    if (source == sources::recording) {
+        // events of a recording are read one at a time, the next one is due at replay_start + its offset from the first
+        read_next();
+        replay_start = clock::now();
+        first_event = event_time(next);
+    } else {
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+}
+
+void rgb_keyboard::key_event_reader::read_next() {
+    end_of_input = ::read(fd, &next, sizeof(next)) != sizeof(next);
+}
+
+rgb_keyboard::key_event_reader::clock::time_point rgb_keyboard::key_event_reader::next_due() const {
+    return replay_start + (event_time(next) - first_event);
+}
+
+void rgb_keyboard::key_event_reader::wait(clock::time_point until) {
+    if (end_of_input)
+        return;
+
+    if (source == sources::recording)
+        until = std::min(until, next_due());
+    const auto now = clock::now();
+    const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(until - now, clock::duration::zero()));
+    const timespec timeout{static_cast<time_t>(remaining.count() / 1000000000), static_cast<long>(remaining.count() % 1000000000)};
+    pollfd input{fd, POLLIN, 0};
+    ppoll(&input, source == sources::recording ? 0 : 1, &timeout, nullptr);
+}
+
+void rgb_keyboard::key_event_reader::handle(const input_event& event, clock::time_point time, std::vector<key_press>& presses) {
+    // presses only, no releases and repeats
+    if (event.type != EV_KEY || event.value != 1)
+        return;
+    const int key = key_index(event.code);
+    if (key >= 0)
+        presses.push_back({key, time});
+}
+
+void rgb_keyboard::key_event_reader::read(std::vector<key_press>& presses) {
+    if (end_of_input)
+        return;
+
+    const auto now = clock::now();
+    if (source == sources::recording) {
+        while (!end_of_input && next_due() <= now) {
+            handle(next, next_due(), presses);
+            read_next();
+        }
+        return;
+    }
+
+    for (;;) {
+        const ssize_t length = ::read(fd, events.data(), sizeof(events));
+        if (length <= 0) {
+            end_of_input = length == 0 || (errno != EAGAIN && errno != EINTR);
+            return;
+        }
+        for (std::size_t i = 0; i < static_cast<std::size_t>(length) / sizeof(input_event); i++)
+            handle(events[i], source == sources::device ? event_time(events[i]) : now, presses);
+    }
+}
@@ -0,0 +1,89 @@
+// key presses read from evdev devices and recordings
+#ifndef RGB_KEYBOARD_KEY_EVENTS
+#define RGB_KEYBOARD_KEY_EVENTS
+
+#include <array>
+#include <chrono>
+#include <vector>
+
+#include <linux/input.h>
+
+namespace rgb_keyboard {
+
+    /**
+     * This class reads key presses from a file descriptor containing input_event records.
+     *
+     * The descriptor is an evdev device (/dev/input/eventN), a pipe or a regular file. Device events
+     * are switched to monotonic time stamps, so a press has the time the kernel received it. Events
+     * of a pipe have the time they were read. A regular file is a recording and is replayed with the
+     * timing of its events, relative to the construction of the reader.
+     */
+    class key_event_reader {
+     public:
+        using clock = std::chrono::steady_clock;
+
+        /// A key press
+        struct key_press {
+            /// Key index of the led
+            int key;
+            /// Time of the event
+            clock::time_point time;
+        };
+
+        /** Get the key index of an evdev key code
+         * \return Key index, -1 if the key has no led
+         */
+        static int key_index(unsigned int code);
+
+        /// Start reading from a file descriptor, the descriptor is not closed
+        explicit key_event_reader(int fd);
+
+        /** Sleep until input is available, the next event of a recording is due or a time is reached
+         * Returns early if a signal is received.
+         */
+        void wait(clock::time_point until);
+
+        /** Read all available key presses, releases and repeats are skipped
+         * \param presses The presses are appended to this vector
+         */
+        void read(std::vector<key_press>& presses);
+
+        /// Returns true after the end of the input
+        [[nodiscard]] bool ended() const { return end_of_input; }
+
+     private:
+        /// Where the events come from
+        enum class sources {
+            /// evdev device, events have the kernel time stamp
+            device,
+            /// pipe, events have the time they were read
+            pipe,
+            /// regular file, events are replayed with their recorded timing
+            recording
+        };
+
+        /// Append an event if it is a key press
+        void handle(const input_event& event, clock::time_point time, std::vector<key_press>& presses);
+        /// Read the next event of a recording
+        void read_next();
+        /// Time the next event of a recording is due
+        [[nodiscard]] clock::time_point next_due() const;
+
+        int fd;
+        sources source = sources::pipe;
+        bool end_of_input = false;
+
+        /// Next event of a recording
+        input_event next{};
+        /// Start of the replay
+        clock::time_point replay_start;
+        /// Time stamp of the first event of the recording
+        clock::time_point first_event;
+
+        /// Read buffer of devices and pipes
+        std::array<input_event, 64> events{};
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
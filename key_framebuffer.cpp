@@ -0,0 +1,197 @@
+#include "key_framebuffer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RGB_KEYBOARD_X86
+#endif
+
+namespace {
+    // planar to packed rgb, portable version
+    void interleave_scalar(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out) {
+        for (int i = 0; i < rgb_keyboard::max_keys; i++) {
+            out[3 * i] = r[i];
+            out[3 * i + 1] = g[i];
+            out[3 * i + 2] = b[i];
+        }
+    }
+
+#ifdef RGB_KEYBOARD_X86
+    // shuffle masks: byte j of output vector v takes channel c of key (16v + j) / 3 if (16v + j) % 3 == c, 0x80 selects zero
+    struct shuffle_masks {
+        alignas(16) int8_t mask[3][3][16];
+
+        constexpr shuffle_masks() : mask{} {
+            for (int v = 0; v < 3; v++) {
+                for (int c = 0; c < 3; c++) {
+                    for (int j = 0; j < 16; j++) {
+                        int position = 16 * v + j;
+                        mask[v][c][j] = (position % 3 == c) ? static_cast<int8_t>(position / 3) : static_cast<int8_t>(0x80);
+                    }
+                }
+            }
+        }
+    };
+    constexpr shuffle_masks masks;
+
+    // planar to packed rgb, 16 keys (48 bytes) per iteration
+    __attribute__((target("ssse3"))) void interleave_ssse3(const uint8_t* r, const uint8_t* g, const uint8_t* b, uint8_t* out) {
+        for (int i = 0; i < rgb_keyboard::max_keys; i += 16) {
+            __m128i red = _mm_load_si128(reinterpret_cast<const __m128i*>(r + i));
+            __m128i green = _mm_load_si128(reinterpret_cast<const __m128i*>(g + i));
+            __m128i blue = _mm_load_si128(reinterpret_cast<const __m128i*>(b + i));
+
+            for (int v = 0; v < 3; v++) {
+                __m128i packed = _mm_or_si128(
+                    _mm_or_si128(_mm_shuffle_epi8(red, _mm_load_si128(reinterpret_cast<const __m128i*>(masks.mask[v][0]))),
+                                 _mm_shuffle_epi8(green, _mm_load_si128(reinterpret_cast<const __m128i*>(masks.mask[v][1])))),
+                    _mm_shuffle_epi8(blue, _mm_load_si128(reinterpret_cast<const __m128i*>(masks.mask[v][2]))));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 3 * i + 16 * v), packed);
+            }
+        }
+    }
+#endif
+
+    // select the fastest implementation once
+    using interleave_function = void (*)(const uint8_t*, const uint8_t*, const uint8_t*, uint8_t*);
+    interleave_function select_interleave() {
+#ifdef RGB_KEYBOARD_X86
+        if (__builtin_cpu_supports("ssse3"))
+            return interleave_ssse3;
+#endif
+        return interleave_scalar;
+    }
+}  // namespace
+
+void rgb_keyboard::key_framebuffer::set(int key, const color& value) {
+    if (key < 0 || key >= max_keys)
+        return;
+
+    r[key] = value[0];
+    g[key] = value[1];
+    b[key] = value[2];
+    mask[key / 64] |= uint64_t(1) << (key % 64);
+}
+
+void rgb_keyboard::key_framebuffer::set(const uint8_t* keys, const color* values, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++)
+        set(keys[i], values[i]);
+}
+
+void rgb_keyboard::key_framebuffer::set(const uint8_t* keys, std::size_t count, const color& value) {
+    for (std::size_t i = 0; i < count; i++)
+        set(keys[i], value);
+}
+
+void rgb_keyboard::key_framebuffer::set(const key_set& keys, const color& value) {
+    // masked fill: every byte of the channels is written, selected bytes take the new value
+    for (int word = 0; word < max_keys / 64; word++) {
+        uint64_t bits = keys.words[word];
+        for (int i = 0; i < 64; i++) {
+            uint8_t select = -static_cast<uint8_t>((bits >> i) & 1);
+            int key = word * 64 + i;
+            r[key] = (r[key] & ~select) | (value[0] & select);
+            g[key] = (g[key] & ~select) | (value[1] & select);
+            b[key] = (b[key] & ~select) | (value[2] & select);
+        }
+        mask[word] |= bits;
+    }
+}
+
+void rgb_keyboard::key_framebuffer::set(const key_set& keys, const uint8_t* red, const uint8_t* green, const uint8_t* blue) {
+    // masked copy, same as the masked fill above
+    for (int word = 0; word < max_keys / 64; word++) {
+        uint64_t bits = keys.words[word];
+        for (int i = 0; i < 64; i++) {
+            uint8_t select = -static_cast<uint8_t>((bits >> i) & 1);
+            int key = word * 64 + i;
+            r[key] = (r[key] & ~select) | (red[key] & select);
+            g[key] = (g[key] & ~select) | (green[key] & select);
+            b[key] = (b[key] & ~select) | (blue[key] & select);
+        }
+        mask[word] |= bits;
+    }
+}
+
+void rgb_keyboard::key_framebuffer::unset(int key) {
+    if (key < 0 || key >= max_keys)
+        return;
+
+    mask[key / 64] &= ~(uint64_t(1) << (key % 64));
+}
+
+void rgb_keyboard::key_framebuffer::clear() {
+    mask.fill(0);
+}
+
+bool rgb_keyboard::key_framebuffer::is_set(int key) const {
+    if (key < 0 || key >= max_keys)
+        return false;
+
+    return (mask[key / 64] >> (key % 64)) & 1;
+}
+
+rgb_keyboard::color rgb_keyboard::key_framebuffer::get(int key) const {
+    if (key < 0 || key >= max_keys)
+        return {0, 0, 0};
+
+    return {r[key], g[key], b[key]};
+}
+
+std::size_t rgb_keyboard::key_framebuffer::count() const {
+    std::size_t result = 0;
+    for (auto word : mask)
+        result += __builtin_popcountll(word);
+
+    return result;
+}
+
+void rgb_keyboard::key_framebuffer::map(const std::array<std::array<uint8_t, 256>, 3>& tables) {
+    // one pass over each channel, keys without a color are mapped as well
+    for (int i = 0; i < max_keys; i++)
+        r[i] = tables[0][r[i]];
+    for (int i = 0; i < max_keys; i++)
+        g[i] = tables[1][g[i]];
+    for (int i = 0; i < max_keys; i++)
+        b[i] = tables[2][b[i]];
+}
+
+void rgb_keyboard::key_framebuffer::interleave(uint8_t* out) const {
+    static const interleave_function function = select_interleave();
+    function(r.data(), g.data(), b.data(), out);
+}
+
+rgb_keyboard::key_framebuffer rgb_keyboard::key_framebuffer::difference(const key_framebuffer& shadow) const {
+    key_framebuffer result = *this;
+
+    // compare all keys branchless, the result only depends on the masks
+    std::array<uint8_t, max_keys> changed;
+    for (int i = 0; i < max_keys; i++)
+        changed[i] = (r[i] ^ shadow.r[i]) | (g[i] ^ shadow.g[i]) | (b[i] ^ shadow.b[i]);
+
+    for (int word = 0; word < max_keys / 64; word++) {
+        uint64_t bits = 0;
+        for (int i = 0; i < 64; i++)
+            bits |= static_cast<uint64_t>(changed[word * 64 + i] != 0) << i;
+
+        result.mask[word] = mask[word] & (~shadow.mask[word] | bits);
+    }
+
+    return result;
+}
+
+void rgb_keyboard::key_framebuffer::merge(const key_framebuffer& other) {
+    other.for_each([&](int key) { set(key, other.get(key)); });
+}
+
+bool rgb_keyboard::key_framebuffer::operator==(const key_framebuffer& other) const {
+    if (mask != other.mask)
+        return false;
+
+    bool equal = true;
+    for_each([&](int key) { equal = equal && get(key) == other.get(key); });
+    return equal;
+}
+
+bool rgb_keyboard::key_framebuffer::operator!=(const key_framebuffer& other) const {
+    return !(*this == other);
+}
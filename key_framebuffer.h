@@ -0,0 +1,157 @@
+// per key colors for the custom led mode
+#ifndef RGB_KEYBOARD_KEY_FRAMEBUFFER
+#define RGB_KEYBOARD_KEY_FRAMEBUFFER
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace rgb_keyboard {
+
+    /** Number of key indices
+     * The key index of a key is its led address divided by 3, every key index fits into 2 64 bit words.
+     */
+    constexpr int max_keys = 128;
+
+    /// A color: red, green, blue
+    using color = std::array<uint8_t, 3>;
+
+    /**
+     * A set of keys, one bit per key index.
+     *
+     * Bit n of word n / 64 is key n. All operations work on whole words.
+     */
+    struct key_set {
+        std::array<uint64_t, max_keys / 64> words{};
+
+        /// Add a key, invalid key indices are ignored
+        constexpr void set(int key) {
+            if (key >= 0 && key < max_keys)
+                words[key / 64] |= uint64_t(1) << (key % 64);
+        }
+        /// Returns true if the key is in the set
+        [[nodiscard]] constexpr bool test(int key) const { return key >= 0 && key < max_keys && ((words[key / 64] >> (key % 64)) & 1); }
+        /// Number of keys in the set
+        [[nodiscard]] std::size_t count() const {
+            std::size_t result = 0;
+            for (auto word : words)
+                result += __builtin_popcountll(word);
+            return result;
+        }
+
+        /// Union
+        constexpr key_set operator|(const key_set& other) const {
+            key_set result;
+            for (std::size_t i = 0; i < words.size(); i++)
+                result.words[i] = words[i] | other.words[i];
+            return result;
+        }
+        /// Intersection
+        constexpr key_set operator&(const key_set& other) const {
+            key_set result;
+            for (std::size_t i = 0; i < words.size(); i++)
+                result.words[i] = words[i] & other.words[i];
+            return result;
+        }
+        /// Difference
+        constexpr key_set operator-(const key_set& other) const {
+            key_set result;
+            for (std::size_t i = 0; i < words.size(); i++)
+                result.words[i] = words[i] & ~other.words[i];
+            return result;
+        }
+        bool operator==(const key_set& other) const { return words == other.words; }
+        bool operator!=(const key_set& other) const { return words != other.words; }
+    };
+
+    /**
+     * This class stores the custom led color of each key.
+     *
+     * Colors are stored in planar form (one 64 byte aligned array per color channel)
+     * indexed by the key index. A bit mask stores which keys have a color, only these
+     * keys are sent to the keyboard.
+     */
+    class alignas(64) key_framebuffer {
+     public:
+        /// Set the color of a key
+        void set(int key, const color& value);
+        /// Set the colors of count keys
+        void set(const uint8_t* keys, const color* values, std::size_t count);
+        /// Set count keys to the same color
+        void set(const uint8_t* keys, std::size_t count, const color& value);
+        /// Set all keys in a set to the same color
+        void set(const key_set& keys, const color& value);
+        /** Set all keys in a set to colors from planar channels
+         * \param red, green, blue max_keys values each, indexed by the key index
+         */
+        void set(const key_set& keys, const uint8_t* red, const uint8_t* green, const uint8_t* blue);
+        /// Remove the color of a key
+        void unset(int key);
+        /// Remove all colors
+        void clear();
+
+        /// Returns true if the key has a color
+        [[nodiscard]] bool is_set(int key) const;
+        /// Get the color of a key
+        [[nodiscard]] color get(int key) const;
+        /// Number of keys that have a color
+        [[nodiscard]] std::size_t count() const;
+        /// Keys that have a color
+        [[nodiscard]] key_set keys() const { return {mask}; }
+
+        /** Get the keys that changed compared to a shadow copy
+         * \param shadow The colors the keyboard is known to display
+         * \return The keys that have a color here, but no color or a different color in shadow
+         */
+        [[nodiscard]] key_framebuffer difference(const key_framebuffer& shadow) const;
+        /// Copy the colors of all keys that have a color in other
+        void merge(const key_framebuffer& other);
+
+        /** Replace the color of every key by an entry of a lookup table
+         * \param tables 256 entry lookup table for red, green and blue
+         */
+        void map(const std::array<std::array<uint8_t, 256>, 3>& tables);
+
+        /** Convert to the format used in the data packets: red, green, blue for each key
+         * \param out max_keys * 3 bytes, the color of a key is stored at key index * 3
+         */
+        void interleave(uint8_t* out) const;
+
+        /// Call function(key index) for each key that has a color, in ascending order
+        template <typename F>
+        void for_each(F function) const {
+            for (int word = 0; word < max_keys / 64; word++) {
+                uint64_t bits = mask[word];
+                while (bits != 0) {
+                    function(word * 64 + __builtin_ctzll(bits));
+                    bits &= bits - 1;
+                }
+            }
+        }
+
+        /// Red channel of all keys
+        [[nodiscard]] const uint8_t* red() const { return r.data(); }
+        /// Green channel of all keys
+        [[nodiscard]] const uint8_t* green() const { return g.data(); }
+        /// Blue channel of all keys
+        [[nodiscard]] const uint8_t* blue() const { return b.data(); }
+
+        /// Compares colors of all keys that have a color
+        bool operator==(const key_framebuffer& other) const;
+        /// \see operator==
+        bool operator!=(const key_framebuffer& other) const;
+
+     private:
+        /// Red channel
+        alignas(64) std::array<uint8_t, max_keys> r{};
+        /// Green channel
+        alignas(64) std::array<uint8_t, max_keys> g{};
+        /// Blue channel
+        alignas(64) std::array<uint8_t, max_keys> b{};
+        /// Keys that have a color, bit n of word n / 64 is key n
+        std::array<uint64_t, max_keys / 64> mask{};
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
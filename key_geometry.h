@@ -0,0 +1,155 @@
+// physical positions of the keys
+#ifndef RGB_KEYBOARD_KEY_GEOMETRY
+#define RGB_KEYBOARD_KEY_GEOMETRY
+
+#include <array>
+#include <cstdint>
+
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * Physical position and size of each key of a led layout.
+     *
+     * Stored as structure of arrays indexed by the key index, so that effects can evaluate
+     * all keys in one loop. Positions are in key units (the width of a letter key), measured
+     * from the top left corner of the keyboard. Everything is computed at compile time from
+     * a list of key rectangles, see add() and finish().
+     */
+    struct key_geometry {
+        /// Maximum number of neighbours of a key
+        static constexpr int max_neighbours = 16;
+        /// Keys are neighbours if the horizontal gap between them is at most this (key units)
+        static constexpr float neighbour_gap_x = 0.3f;
+        /// Keys are neighbours if the vertical gap between them is at most this, covers the gap below the function key row
+        static constexpr float neighbour_gap_y = 0.55f;
+
+        /// Horizontal position of the key center
+        alignas(64) std::array<float, max_keys> x{};
+        /// Vertical position of the key center
+        alignas(64) std::array<float, max_keys> y{};
+        /// Width of the key
+        alignas(64) std::array<float, max_keys> w{};
+        /// Height of the key
+        alignas(64) std::array<float, max_keys> h{};
+        /// Row of the key (0 = function key row), keys spanning two rows belong to the upper one
+        std::array<uint8_t, max_keys> row{};
+        /// Column of the key, counted from the left in its row
+        std::array<uint8_t, max_keys> column{};
+        /// Keys that have a position
+        key_set keys;
+        /// Width of the layout
+        float width = 0;
+        /// Height of the layout
+        float height = 0;
+
+        /// Number of neighbours of each key
+        std::array<uint8_t, max_keys> neighbour_count{};
+        /// Neighbours of each key (adjacent keys, also diagonally), sorted by key index
+        std::array<std::array<uint8_t, max_neighbours>, max_keys> neighbours{};
+        /// Distance between the centers of two keys, 0 if one of them has no position
+        std::array<std::array<float, max_keys>, max_keys> distance{};
+
+        /** Add a key
+         * \param key Key index
+         * \param center_x, center_y Center of the key
+         * \param key_width, key_height Size of the key
+         */
+        constexpr void add(int key, float center_x, float center_y, float key_width = 1, float key_height = 1) {
+            x[key] = center_x;
+            y[key] = center_y;
+            w[key] = key_width;
+            h[key] = key_height;
+            keys.set(key);
+
+            width = width > center_x + key_width / 2 ? width : center_x + key_width / 2;
+            height = height > center_y + key_height / 2 ? height : center_y + key_height / 2;
+        }
+
+        /// Compute rows, columns, neighbours and distances after all keys were added
+        constexpr void finish() {
+            // row from the top edge: the function key row starts at 0, the other rows at 1.5, 2.5, ...
+            for (int key = 0; key < max_keys; key++) {
+                if (keys.test(key)) {
+                    float top = y[key] - h[key] / 2;
+                    row[key] = top < 1 ? 0 : static_cast<uint8_t>(top - 0.5f);
+                }
+            }
+
+            for (int a = 0; a < max_keys; a++) {
+                if (!keys.test(a))
+                    continue;
+
+                for (int b = 0; b < max_keys; b++) {
+                    if (!keys.test(b) || a == b)
+                        continue;
+
+                    // column: number of keys left of a in the same row
+                    if (row[b] == row[a] && x[b] < x[a])
+                        column[a]++;
+
+                    float dx = x[b] - x[a], dy = y[b] - y[a];
+                    distance[a][b] = sqrt(dx * dx + dy * dy);
+
+                    // neighbours: the gap between the rectangles is small in both directions
+                    float gap_x = abs(dx) - (w[a] + w[b]) / 2;
+                    float gap_y = abs(dy) - (h[a] + h[b]) / 2;
+                    if (gap_x <= neighbour_gap_x && gap_y <= neighbour_gap_y && neighbour_count[a] < max_neighbours)
+                        neighbours[a][neighbour_count[a]++] = b;
+                }
+            }
+        }
+
+        /** Sample a 2D field at the center of every key
+         * The loop runs over all key indices without branches, so it vectorizes if field can be inlined.
+         * Keys without a position are sampled at (0, 0).
+         * \param field Function float(float x, float y), positions in key units
+         * \param out max_keys values, indexed by the key index
+         */
+        template <typename F>
+        void rasterize(F field, float* out) const {
+            const float* px = x.data();
+            const float* py = y.data();
+            for (int i = 0; i < max_keys; i++)
+                out[i] = field(px[i], py[i]);
+        }
+
+        /** Average a 2D field over the area of every key
+         * Samples a grid of samples x samples points inside each key, e.g. to map an image to the keys.
+         * \see rasterize()
+         */
+        template <typename F>
+        void rasterize_area(F field, int samples, float* out) const {
+            for (int i = 0; i < max_keys; i++)
+                out[i] = 0;
+
+            const float weight = 1.0f / (samples * samples);
+            for (int sy = 0; sy < samples; sy++) {
+                for (int sx = 0; sx < samples; sx++) {
+                    // sample position relative to the key size, -0.5 to 0.5
+                    const float fx = (sx + 0.5f) / samples - 0.5f;
+                    const float fy = (sy + 0.5f) / samples - 0.5f;
+                    for (int i = 0; i < max_keys; i++)
+                        out[i] += weight * field(x[i] + fx * w[i], y[i] + fy * h[i]);
+                }
+            }
+        }
+
+     private:
+        static constexpr float abs(float v) { return v < 0 ? -v : v; }
+
+        // square root with Newton's method, std::sqrt isn't constexpr
+        static constexpr float sqrt(float v) {
+            if (v <= 0)
+                return 0;
+            double r = v > 1 ? v : 1;
+            for (int i = 0; i < 32; i++)
+                r = 0.5 * (r + v / r);
+            return static_cast<float>(r);
+        }
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
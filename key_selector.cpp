@@ -0,0 +1,156 @@
+#include "key_selector.h"
+
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "rgb_keyboard.h"
+
+namespace {
+    using rgb_keyboard::key_set;
+
+    // key set from a list of key names
+    key_set from_names(std::initializer_list<std::string_view> names) {
+        key_set result;
+        for (auto name : names)
+            result.set(rgb_keyboard::keyboard::get_led_key_index(name));
+        return result;
+    }
+
+    // the named key groups, resolved once
+    struct key_groups {
+        std::array<key_set, 6> rows;
+        key_set all, alpha, digits, fkeys, numpad, mods, arrows, nav;
+
+        key_groups() {
+            // rows of the full size layout, top to bottom
+            rows[0] = from_names({"Esc", "F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12", "PrtSc", "ScrLk", "Pause"});
+            rows[1] = from_names({"Tilde", "1", "2", "3", "4", "5", "6", "7", "8", "9", "0", "Minus", "Equals", "Backspace", "Insert", "Home", "PgUp",
+                                  "Num_Lock", "Num_Slash", "Num_Asterisk", "Num_Minus"});
+            rows[2] = from_names({"Tab", "q", "w", "e", "r", "t", "y", "u", "i", "o", "p", "Bracket_l", "Bracket_r", "Backslash", "Delete", "End", "PgDn",
+                                  "Num_7", "Num_8", "Num_9", "Num_Plus"});
+            rows[3] = from_names({"Caps_Lock", "a", "s", "d", "f", "g", "h", "j", "k", "l", "Semicolon", "Apostrophe", "Return", "Num_4", "Num_5", "Num_6"});
+            rows[4] = from_names({"Shift_l", "Int_Key", "z", "x", "c", "v", "b", "n", "m", "Comma", "Period", "Slash", "Shift_r", "Up", "Num_1", "Num_2",
+                                  "Num_3", "Num_Return"});
+            rows[5] = from_names({"Ctrl_l", "Super_l", "Alt_l", "Space", "Alt_r", "Fn", "Menu", "Ctrl_r", "Left", "Down", "Right", "Num_0", "Num_Period"});
+
+            for (const auto& row : rows)
+                all = all | row;
+
+            alpha = from_names({"a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m",
+                                "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z"});
+            digits = from_names({"1", "2", "3", "4", "5", "6", "7", "8", "9", "0"});
+            fkeys = from_names({"F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12"});
+            numpad = from_names({"Num_Lock", "Num_Slash", "Num_Asterisk", "Num_Minus", "Num_Plus", "Num_Return", "Num_Period", "Num_0", "Num_1", "Num_2",
+                                 "Num_3", "Num_4", "Num_5", "Num_6", "Num_7", "Num_8", "Num_9"});
+            mods = from_names({"Shift_l", "Shift_r", "Ctrl_l", "Ctrl_r", "Alt_l", "Alt_r", "Super_l", "Fn"});
+            arrows = from_names({"Left", "Down", "Up", "Right"});
+            nav = from_names({"Insert", "Home", "PgUp", "Delete", "End", "PgDn"});
+        }
+
+        // get a group by name, nullptr if unknown
+        const key_set* find(std::string_view name) const {
+            if (name == "all")
+                return &all;
+            if (name == "alpha")
+                return &alpha;
+            if (name == "digits")
+                return &digits;
+            if (name == "fkeys")
+                return &fkeys;
+            if (name == "numpad")
+                return &numpad;
+            if (name == "mods")
+                return &mods;
+            if (name == "arrows")
+                return &arrows;
+            if (name == "nav")
+                return &nav;
+            return nullptr;
+        }
+    };
+
+    const key_groups& groups() {
+        static const key_groups result;
+        return result;
+    }
+
+    // resolve a single term
+    key_set parse_term(std::string_view term) {
+        // row:N
+        if (term.substr(0, 4) == "row:") {
+            std::string_view number = term.substr(4);
+            if (number.size() != 1 || number[0] < '0' || number[0] > '5')
+                throw std::invalid_argument("Invalid key row: " + std::string(term));
+            return groups().rows[number[0] - '0'];
+        }
+
+        // named group
+        if (const key_set* group = groups().find(term))
+            return *group;
+
+        // range of keys
+        std::size_t dash = term.find('-');
+        if (dash != std::string_view::npos && dash != 0 && dash != term.size() - 1) {
+            int first = rgb_keyboard::keyboard::get_led_key_index(term.substr(0, dash));
+            int last = rgb_keyboard::keyboard::get_led_key_index(term.substr(dash + 1));
+            if (first < 0 || last < 0)
+                throw std::invalid_argument("Invalid key range: " + std::string(term));
+            if (first > last)
+                std::swap(first, last);
+
+            key_set result;
+            for (int key = first; key <= last; key++)
+                result.set(key);
+            return result & groups().all;
+        }
+
+        // single key, a typo must not turn into an empty set inside an expression
+        int key = rgb_keyboard::keyboard::get_led_key_index(term);
+        if (key < 0)
+            throw std::invalid_argument("Unknown key or group: " + std::string(term));
+        key_set result;
+        result.set(key);
+        return result;
+    }
+}  // namespace
+
+rgb_keyboard::key_set rgb_keyboard::parse_key_selector(std::string_view selector) {
+    key_set result;
+    char operation = '+';
+    bool expect_term = true;
+    bool empty = true;
+
+    while (!selector.empty()) {
+        // next whitespace separated token
+        std::size_t start = selector.find_first_not_of(" \t");
+        if (start == std::string_view::npos)
+            break;
+        selector.remove_prefix(start);
+        std::size_t end = selector.find_first_of(" \t");
+        std::string_view token = selector.substr(0, end);
+        selector.remove_prefix(token.size());
+
+        if (!expect_term) {
+            if (token != "+" && token != "-" && token != "&")
+                throw std::invalid_argument("Expected + - or & in key selector, got: " + std::string(token));
+            operation = token[0];
+        } else {
+            key_set term = parse_term(token);
+            if (operation == '+')
+                result = result | term;
+            else if (operation == '-')
+                result = result - term;
+            else
+                result = result & term;
+        }
+        expect_term = !expect_term;
+        empty = false;
+    }
+
+    if (expect_term && !empty)
+        throw std::invalid_argument("Missing key selector after operator");
+
+    return result;
+}
@@ -0,0 +1,28 @@
+// key group selectors for custom patterns
+#ifndef RGB_KEYBOARD_KEY_SELECTOR
+#define RGB_KEYBOARD_KEY_SELECTOR
+
+#include <string_view>
+
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    /** Resolve a key selector to a set of keys
+     *
+     * A selector is a list of terms separated by the operators + (union), - (difference)
+     * and & (intersection), evaluated from left to right. Operators must be surrounded by spaces.
+     * A term is one of:
+     * - a key name, e.g. Caps_Lock
+     * - a range of key names, e.g. F1-F12, all keys between the two keys in led address order
+     * - a row of the full size layout, row:0 (the function key row) to row:5 (the space bar row)
+     * - a named group: all, alpha, digits, fkeys, numpad, mods, arrows, nav
+     *
+     * Example: "all - numpad - row:0"
+     * \throws std::invalid_argument if the selector is malformed or names an unknown key or group
+     */
+    key_set parse_key_selector(std::string_view selector);
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,162 @@
+#include "keymap_parser.h"
+
+#include <string>
+
+namespace {
+    // true if text is a single word
+    bool is_word(std::string_view text) {
+        return !text.empty() && text.find_first_of(" \t=[]") == std::string_view::npos;
+    }
+
+    // parse a decimal number, false if text isn't a number or greater than limit
+    bool parse_number(std::string_view text, unsigned int limit, unsigned int& result) {
+        if (text.empty())
+            return false;
+
+        unsigned long value = 0;
+        for (char c : text) {
+            if (c < '0' || c > '9')
+                return false;
+            value = value * 10 + (c - '0');
+            if (value > limit)
+                return false;
+        }
+
+        result = value;
+        return true;
+    }
+
+    // split text at the first =, false if there is none
+    bool split(std::string_view text, std::string_view& left, std::string_view& right) {
+        std::size_t equals = text.find('=');
+        if (equals == std::string_view::npos)
+            return false;
+
+        left = rgb_keyboard::trim(text.substr(0, equals));
+        right = rgb_keyboard::trim(text.substr(equals + 1));
+        return true;
+    }
+}  // namespace
+
+int rgb_keyboard::macro_number(std::string_view name) {
+    if (name.substr(0, 5) != "macro")
+        return -1;
+
+    // larger numbers are invalid anyway, they are only limited to avoid overflows
+    unsigned int number;
+    if (!parse_number(name.substr(5), 1000000, number))
+        return -1;
+    return number;
+}
+
+rgb_keyboard::keymap_config rgb_keyboard::parse_keymap(std::string_view text) {
+    keymap_config result;
+
+    // current section: 0 = [keymap], 1-100 = [macroN], -1 = any other section
+    int section = -1;
+    std::size_t line_number = 1;
+    const char* line_start = text.data();
+
+    auto error = [&](std::string_view position, std::string message) {
+        result.diagnostics.push_back({line_number, std::size_t(position.data() - line_start) + 1, std::move(message)});
+    };
+
+    for (; !text.empty(); line_number++) {
+        line_start = text.data();
+        std::size_t end = text.find('\n');
+        std::string_view line = rgb_keyboard::trim(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        // empty or comment?
+        if (line.empty() || line[0] == ';' || line[0] == '#')
+            continue;
+
+        // section header?
+        if (line[0] == '[') {
+            if (line.back() != ']') {
+                error(line.substr(line.size()), "Expected ]");
+                section = -1;
+                continue;
+            }
+
+            std::string_view name = rgb_keyboard::trim(line.substr(1, line.size() - 2));
+            if (name == "keymap") {
+                section = 0;
+            } else if (int number = macro_number(name); number >= 0) {
+                section = number;
+                if (number < 1 || number > max_macros) {
+                    error(name, "Macro number must be 1-" + std::to_string(max_macros));
+                    section = -1;
+                }
+            } else {
+                section = -1;
+            }
+            continue;
+        }
+
+        // lines of unknown sections are ignored
+        if (section < 0)
+            continue;
+
+        std::string_view left, right;
+        if (!split(line, left, right)) {
+            error(line.substr(line.size()), section == 0 ? "Expected key=function" : "Expected repeat=N or up/down=key=delay");
+            continue;
+        }
+        if (!is_word(left)) {
+            error(left, "Invalid name '" + std::string(left) + "'");
+            continue;
+        }
+
+        // key=function
+        if (section == 0) {
+            if (!is_word(right)) {
+                error(right, "Invalid function '" + std::string(right) + "'");
+                continue;
+            }
+            result.mappings.push_back({left, right});
+            continue;
+        }
+
+        // repeat=N
+        if (left == "repeat") {
+            unsigned int repeats;
+            if (!parse_number(right, 255, repeats)) {
+                error(right, "Expected number of repeats 0-255, got '" + std::string(right) + "'");
+                continue;
+            }
+            result.repeats.push_back({section, repeats});
+            continue;
+        }
+
+        // up=key=delay or down=key=delay
+        macro::action_type type;
+        if (left == "up") {
+            type = macro::t_up;
+        } else if (left == "down") {
+            type = macro::t_down;
+        } else {
+            error(left, "Expected repeat, up or down, got '" + std::string(left) + "'");
+            continue;
+        }
+
+        std::string_view key, delay_string;
+        if (!split(right, key, delay_string)) {
+            error(right.substr(right.size()), "Expected =delay");
+            continue;
+        }
+        if (!is_word(key)) {
+            error(key, "Invalid key '" + std::string(key) + "'");
+            continue;
+        }
+        unsigned int delay;
+        if (!parse_number(delay_string, macro::max_delay, delay)) {
+            error(delay_string, "Expected delay 0-" + std::to_string(macro::max_delay) + ", got '" + std::string(delay_string) + "'");
+            continue;
+        }
+
+        result.actions.push_back({section, type, key, delay});
+    }
+
+    return result;
+}
@@ -0,0 +1,66 @@
+// single pass parser for keymap files
+#ifndef RGB_KEYBOARD_KEYMAP_PARSER
+#define RGB_KEYBOARD_KEYMAP_PARSER
+
+#include <string_view>
+#include <vector>
+
+#include "macro.h"
+#include "pattern_parser.h"
+
+namespace rgb_keyboard {
+
+    /// Number of macros, macros are named macro1 to macro100
+    constexpr int max_macros = 100;
+
+    /**
+     * Contents of a keymap file.
+     *
+     * All strings point into the parsed text.
+     */
+    struct keymap_config {
+        /// A line of the [keymap] section: key=function
+        struct mapping {
+            std::string_view key;
+            std::string_view function;
+        };
+        /// A line of a [macroN] section: up/down=key=delay
+        struct macro_action {
+            int macro;
+            macro::action_type type;
+            std::string_view key;
+            unsigned int delay;
+        };
+        /// A line of a [macroN] section: repeat=N
+        struct macro_repeat {
+            int macro;
+            unsigned int repeats;
+        };
+
+        /// Key mappings in file order
+        std::vector<mapping> mappings;
+        /// Macro actions in file order
+        std::vector<macro_action> actions;
+        /// Macro repeats in file order
+        std::vector<macro_repeat> repeats;
+        /// One diagnostic for each malformed line, empty if the file is valid
+        std::vector<parse_diagnostic> diagnostics;
+    };
+
+    /** Parse a keymap file in a single pass
+     *
+     * The file consists of a [keymap] section with key=function lines and [macroN] sections (N = 1-100)
+     * with repeat=N and up=key=delay/down=key=delay lines. Lines starting with ; or # are comments,
+     * whitespace around names and values is ignored. Lines of other sections are ignored.
+     * Malformed lines are reported in diagnostics, all other lines are still stored.
+     */
+    keymap_config parse_keymap(std::string_view text);
+
+    /** Get the number of a macro name
+     * \return N for "macroN", -1 if name is not a macro name
+     */
+    int macro_number(std::string_view name);
+
+}  // namespace rgb_keyboard
+
+#endif
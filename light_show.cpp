@@ -0,0 +1,369 @@
+#include "light_show.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#include "rgb_keyboard.h"
+
+namespace {
+    using rgb_keyboard::color;
+    using rgb_keyboard::key_framebuffer;
+    using rgb_keyboard::max_keys;
+
+    // bit 7 of the count byte of a run
+    constexpr uint8_t fill_flag = 0x80;
+    // keys per run, the count byte stores count - 1 in 7 bits
+    constexpr int max_run = 128;
+    // same colored keys of at least this length are stored as a fill run, shorter ones cost more than they save
+    constexpr int min_fill = 3;
+
+    /* Append the runs that change the displayed colors into the target colors, and update displayed
+     * Keys displayed before but not in target are turned off, keys in neither are never sent.
+     */
+    void encode_delta(key_framebuffer& displayed, const key_framebuffer& target, std::vector<uint8_t>& out) {
+        std::array<bool, max_keys> changed{};
+        std::array<color, max_keys> values{};
+        for (int key = 0; key < max_keys; key++) {
+            if (!target.is_set(key) && !displayed.is_set(key))
+                continue;
+            values[key] = target.is_set(key) ? target.get(key) : color{0x00, 0x00, 0x00};
+            changed[key] = !displayed.is_set(key) || displayed.get(key) != values[key];
+            if (changed[key])
+                displayed.set(key, values[key]);
+        }
+
+        int key = 0;
+        while (key < max_keys) {
+            if (!changed[key]) {
+                key++;
+                continue;
+            }
+
+            // consecutive changed keys, split into fill runs and runs with a color per key
+            int end = key;
+            while (end < max_keys && changed[end])
+                end++;
+            while (key < end) {
+                int same = key + 1;
+                while (same < end && same - key < max_run && values[same] == values[key])
+                    same++;
+                if (same - key >= min_fill) {
+                    out.push_back(key);
+                    out.push_back((same - key - 1) | fill_flag);
+                    out.insert(out.end(), values[key].begin(), values[key].end());
+                    key = same;
+                    continue;
+                }
+
+                // a run with a color per key stops in front of the next fill run
+                int literal_end = key + 1;
+                while (literal_end < end && literal_end - key < max_run) {
+                    int next = literal_end + 1;
+                    while (next < end && next - literal_end < min_fill && values[next] == values[literal_end])
+                        next++;
+                    if (next - literal_end >= min_fill)
+                        break;
+                    literal_end++;
+                }
+                out.push_back(key);
+                out.push_back(literal_end - key - 1);
+                for (; key < literal_end; key++)
+                    out.insert(out.end(), values[key].begin(), values[key].end());
+            }
+        }
+    }
+
+    // append a record: frame header and runs
+    void append_record(std::vector<uint8_t>& out, uint32_t time, const std::vector<uint8_t>& runs) {
+        rgb_keyboard::light_show::frame_header header{time, static_cast<uint16_t>(runs.size()), 0};
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&header);
+        out.insert(out.end(), bytes, bytes + sizeof(header));
+        out.insert(out.end(), runs.begin(), runs.end());
+    }
+}  // namespace
+
+int rgb_keyboard::light_show::save(const std::string& file, const std::vector<frame>& frames, uint32_t loop_frame, uint32_t duration) {
+    if (frames.empty())
+        throw std::invalid_argument("A light show needs at least one frame");
+    if (loop_frame != no_loop && loop_frame >= frames.size())
+        throw std::invalid_argument("Loop frame " + std::to_string(loop_frame) + " doesn't exist");
+    for (std::size_t i = 1; i < frames.size(); i++) {
+        if (frames[i].time < frames[i - 1].time)
+            throw std::invalid_argument("Frames must be in ascending time order");
+    }
+    if (duration < frames.back().time)
+        throw std::invalid_argument("The show must not end before its last frame");
+    if (loop_frame != no_loop && duration == frames[loop_frame].time)
+        throw std::invalid_argument("The looped part of the show must not be empty");
+
+    // frames, each relative to the colors displayed after the previous one
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> runs;
+    key_framebuffer displayed;
+    key_framebuffer loop_colors;
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        runs.clear();
+        encode_delta(displayed, frames[i].colors, runs);
+        append_record(data, frames[i].time, runs);
+        if (i == loop_frame)
+            loop_colors = displayed;
+    }
+
+    // the loop record turns the last frame back into the loop frame
+    const uint32_t loop_offset = loop_frame != no_loop ? sizeof(file_header) + data.size() : 0;
+    if (loop_frame != no_loop) {
+        runs.clear();
+        encode_delta(displayed, loop_colors, runs);
+        append_record(data, duration, runs);
+    }
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return 1;
+    }
+
+    // prepare header
+    file_header header{};
+    std::memcpy(header.magic, "RGBKSHOW", sizeof(header.magic));
+    header.version = format_version;
+    header.header_size = sizeof(file_header);
+    header.frame_count = frames.size();
+    header.loop_frame = loop_frame;
+    header.duration = duration;
+    header.frames_offset = sizeof(file_header);
+    header.loop_offset = loop_offset;
+
+    // write header and records
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    return out.good() ? 0 : 1;
+}
+
+std::vector<rgb_keyboard::light_show::frame> rgb_keyboard::light_show::read_frames(const std::string& directory, int fps, const key_set& keys) {
+    std::vector<std::filesystem::path> files;
+    for (const auto& file : std::filesystem::directory_iterator(directory)) {
+        if (file.path().extension() == ".conf" || file.path().extension() == ".raw")
+            files.push_back(file.path());
+    }
+    // same show for the same directory contents
+    std::sort(files.begin(), files.end());
+
+    std::vector<frame> frames;
+    auto add = [&](const key_framebuffer& colors) {
+        frames.push_back({static_cast<uint32_t>(frames.size() * 1000 / std::max(fps, 1)), colors});
+    };
+
+    for (const auto& file : files) {
+        if (file.extension() == ".conf") {
+            keyboard pattern_kbd;
+            if (pattern_kbd.load_custom(file.string()) != 0)
+                throw std::invalid_argument("Couldn't open custom pattern file " + file.string());
+            add(pattern_kbd.get_custom_colors());
+            continue;
+        }
+
+        // raw frames: red, green, blue of every key index
+        constexpr std::size_t frame_size = max_keys * 3;
+        mapped_file raw(file.string());
+        if (!raw.is_open())
+            throw std::invalid_argument("Couldn't open frame file " + file.string());
+        const std::string_view bytes = raw.text();
+        if (bytes.size() % frame_size != 0)
+            throw std::invalid_argument(file.string() + " is not a multiple of " + std::to_string(frame_size) + " bytes");
+
+        for (std::size_t begin = 0; begin < bytes.size(); begin += frame_size) {
+            key_framebuffer colors;
+            for (int key = 0; key < max_keys; key++) {
+                if (!keys.test(key))
+                    continue;
+                const auto* value = reinterpret_cast<const uint8_t*>(bytes.data() + begin + key * 3);
+                colors.set(key, color{value[0], value[1], value[2]});
+            }
+            add(colors);
+        }
+    }
+
+    return frames;
+}
+
+bool rgb_keyboard::light_show::check(const uint8_t* runs, std::size_t size) {
+    std::size_t position = 0;
+    while (position < size) {
+        if (size - position < 2)
+            return false;
+        const int key = runs[position];
+        const int count = (runs[position + 1] & ~fill_flag) + 1;
+        const std::size_t length = 2 + 3 * ((runs[position + 1] & fill_flag) != 0 ? 1 : count);
+        if (key + count > max_keys || size - position < length)
+            return false;
+        position += length;
+    }
+    return true;
+}
+
+int rgb_keyboard::light_show::load(const std::string& file) {
+    mapping.reset();
+    data = nullptr;
+    header = nullptr;
+
+    auto loaded_mapping = std::make_unique<mapped_file>(file);
+    if (!loaded_mapping->is_open())
+        return 1;
+    const std::string_view bytes = loaded_mapping->text();
+    if (bytes.size() < sizeof(file_header))
+        return 1;
+
+    // check header
+    const auto* loaded_data = reinterpret_cast<const uint8_t*>(bytes.data());
+    const auto* loaded = reinterpret_cast<const file_header*>(loaded_data);
+    if (std::memcmp(loaded->magic, "RGBKSHOW", sizeof(loaded->magic)) != 0 || loaded->version != format_version ||
+        loaded->header_size != sizeof(file_header) || loaded->frame_count == 0 || loaded->frames_offset < sizeof(file_header) ||
+        (loaded->loop_frame != no_loop && loaded->loop_frame >= loaded->frame_count))
+        return 1;
+
+    // check all records, they may not be aligned
+    auto check_record = [&](std::size_t offset, uint32_t min_time, frame_header& record) {
+        if (offset > bytes.size() || bytes.size() - offset < sizeof(frame_header))
+            return false;
+        std::memcpy(&record, loaded_data + offset, sizeof(record));
+        return record.time >= min_time && record.time <= loaded->duration && bytes.size() - offset - sizeof(record) >= record.size &&
+               check(loaded_data + offset + sizeof(record), record.size);
+    };
+
+    std::size_t offset = loaded->frames_offset;
+    uint32_t time = 0;
+    std::size_t continue_offset = 0;
+    uint32_t loop_frame_time = 0;
+    for (uint32_t i = 0; i < loaded->frame_count; i++) {
+        frame_header record;
+        if (!check_record(offset, time, record))
+            return 1;
+        time = record.time;
+        if (i == loaded->loop_frame)
+            loop_frame_time = time;
+        offset += sizeof(record) + record.size;
+        if (i == loaded->loop_frame)
+            continue_offset = offset;
+    }
+    if (loaded->loop_frame != no_loop) {
+        frame_header record;
+        if (!check_record(loaded->loop_offset, loaded->duration, record) || loop_frame_time == loaded->duration)
+            return 1;
+    }
+
+    mapping = std::move(loaded_mapping);
+    data = loaded_data;
+    header = loaded;
+    loop_continue = continue_offset;
+    loop_time = loop_frame_time;
+
+    return 0;
+}
+
+std::size_t rgb_keyboard::light_show::apply(const uint8_t* runs, std::size_t size, keyboard& kbd) {
+    std::size_t keys = 0;
+    std::size_t position = 0;
+    while (position < size) {
+        const uint8_t key = runs[position];
+        const int count = (runs[position + 1] & ~fill_flag) + 1;
+        const auto* colors = reinterpret_cast<const color*>(runs + position + 2);
+
+        if ((runs[position + 1] & fill_flag) != 0) {
+            key_set fill;
+            for (int i = key; i < key + count; i++)
+                fill.set(i);
+            kbd.set_custom_colors(fill, colors[0]);
+            position += 2 + 3;
+        } else {
+            std::array<uint8_t, max_run> indices;
+            for (int i = 0; i < count; i++)
+                indices[i] = key + i;
+            kbd.set_custom_colors(indices.data(), colors, count);
+            position += 2 + 3 * count;
+        }
+        keys += count;
+    }
+    return keys;
+}
+
+rgb_keyboard::light_show::statistics rgb_keyboard::light_show::play(keyboard& kbd, const volatile std::sig_atomic_t& stop) const {
+    using clock = std::chrono::steady_clock;
+    statistics stats;
+    if (header == nullptr)
+        return stats;
+
+    const bool looping = header->loop_frame != no_loop;
+
+    // position in the show: the next record, its frame index (frame_count for the loop record) and the time added by past loops
+    std::size_t offset = header->frames_offset;
+    uint32_t index = 0;
+    uint64_t loop_shift = 0;
+    auto record_at = [&](std::size_t at) {
+        frame_header record;
+        std::memcpy(&record, data + at, sizeof(record));
+        return record;
+    };
+    auto advance = [&](const frame_header& record) {
+        if (index == header->frame_count) {
+            // after the loop record, continue behind the loop frame
+            loop_shift += header->duration - loop_time;
+            offset = loop_continue;
+            index = header->loop_frame + 1;
+        } else {
+            offset += sizeof(record) + record.size;
+            index++;
+        }
+        if (index == header->frame_count && looping)
+            offset = header->loop_offset;
+    };
+    auto ended = [&]() { return index == header->frame_count && !looping; };
+
+    // start with no keys, the first frame sets all keys of the show
+    kbd.set_custom_pattern({});
+    const auto start = clock::now();
+    bool custom_mode = false;
+    // frames are due at absolute times of the show, the frame rate is not used
+    frame_pacer pacer(1);
+    // the previous frame was late and is sent together with this one
+    bool merging = false;
+
+    while (!stop && !ended()) {
+        const frame_header record = record_at(offset);
+        const auto due = start + std::chrono::milliseconds(loop_shift + record.time);
+        if (!merging && !pacer.wait_until(due, stop))
+            break;
+
+        stats.keys += apply(data + offset + sizeof(record), record.size, kbd);
+        stats.frames++;
+        advance(record);
+
+        // a late player sends the frames that are already due together
+        merging = !ended() && start + std::chrono::milliseconds(loop_shift + record_at(offset).time) <= clock::now();
+        if (merging) {
+            stats.merged++;
+            continue;
+        }
+        pacer.rendered();
+
+        // the first upload switches to the custom mode
+        if (custom_mode) {
+            kbd.write_custom();
+        } else {
+            kbd.write_custom_mode();
+            custom_mode = true;
+        }
+        pacer.sent();
+        stats.uploads++;
+    }
+    stats.timing = pacer.get_statistics();
+
+    // the last frame is shown until the end of the show
+    if (ended())
+        pacer.wait_until(start + std::chrono::milliseconds(header->duration), stop);
+
+    return stats;
+}
@@ -0,0 +1,162 @@
+// pre-authored key color animations stored as frame deltas
+#ifndef RGB_KEYBOARD_LIGHT_SHOW
+#define RGB_KEYBOARD_LIGHT_SHOW
+
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "frame_pacer.h"
+#include "key_framebuffer.h"
+#include "mapped_file.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * This class represents a light show: a sequence of timed custom led frames in one file.
+     *
+     * The first frame stores all keys, every following frame only the keys that changed. Changed
+     * keys with consecutive key indices form a run, a run of keys with the same color stores the
+     * color once. The player memory-maps the file and sends each frame's changes directly, so
+     * memory use and CPU time don't depend on the length of the show.
+     *
+     * File layout (little endian, all offsets from the start of the file):
+     * - 64 byte header (see file_header)
+     * - frame_count frames, each a frame_header followed by its runs
+     * - the loop record: a frame_header and the runs that change the last frame into frame loop_frame
+     *
+     * A run is a key index, a byte with the number of keys - 1 (bits 0-6) and the fill flag (bit 7),
+     * followed by one color (fill) or one color per key (red, green, blue).
+     */
+    class light_show {
+     public:
+        /// Current file format version
+        static constexpr uint16_t format_version = 1;
+        /// loop_frame of a show that ends after the last frame
+        static constexpr uint32_t no_loop = 0xffffffff;
+
+        /// The file header
+        struct file_header {
+            /// Always "RGBKSHOW"
+            char magic[8];
+            /// File format version
+            uint16_t version;
+            /// Size of this header in bytes
+            uint16_t header_size;
+            /// Number of frames
+            uint32_t frame_count;
+            /// Frame shown after the last frame, no_loop if the show ends
+            uint32_t loop_frame;
+            /// Length of the show in milliseconds, the last frame is shown until then
+            uint32_t duration;
+            /// Offset of the first frame
+            uint32_t frames_offset;
+            /// Offset of the loop record
+            uint32_t loop_offset;
+            /// Reserved, always 0
+            uint8_t reserved[32];
+        };
+        static_assert(sizeof(file_header) == 64, "header must be 64 bytes long");
+
+        /// Header of a frame
+        struct frame_header {
+            /// Time the frame is shown, milliseconds from the start of the show
+            uint32_t time;
+            /// Size of the runs in bytes
+            uint16_t size;
+            /// Reserved, always 0
+            uint16_t reserved;
+        };
+        static_assert(sizeof(frame_header) == 8, "frame header must be 8 bytes long");
+
+        /// A frame of a show to be saved
+        struct frame {
+            /// Time the frame is shown, milliseconds from the start of the show
+            uint32_t time;
+            /// Colors of the keys, keys without a color are off
+            key_framebuffer colors;
+        };
+
+        /// Counters of play()
+        struct statistics {
+            /// Frames whose changes were applied
+            std::size_t frames = 0;
+            /// Number of write_custom() calls
+            std::size_t uploads = 0;
+            /// Frames that were applied together with a later frame because the player was late
+            std::size_t merged = 0;
+            /// Key changes applied
+            std::size_t keys = 0;
+            /// Timing of the uploads, the wake ups of merged frames are not counted
+            frame_pacer::statistics timing;
+        };
+
+        /** Write a show file
+         * \param frames Frames in ascending time order, at least one
+         * \param loop_frame Index of the frame shown after the last frame, no_loop if the show ends
+         * \param duration Length of the show in milliseconds, at least the time of the last frame
+         * \return 0 if successful, 1 if the file could not be written
+         * \throws std::invalid_argument if the frames or loop_frame are invalid
+         */
+        static int save(const std::string& file, const std::vector<frame>& frames, uint32_t loop_frame, uint32_t duration);
+
+        /** Read the frames of a directory
+         * Files are used in name order: a .conf file (custom pattern) is one frame, a .raw file
+         * contains frames of max_keys * 3 bytes (red, green, blue for each key index).
+         * \param directory Directory with .conf and .raw files
+         * \param fps Frames per second, frame n is shown at n / fps seconds
+         * \param keys Keys of the led layout, keys of .raw frames not in this set are ignored
+         * \throws std::invalid_argument if a pattern file has errors or a .raw file size isn't a multiple of a frame
+         */
+        static std::vector<frame> read_frames(const std::string& directory, int fps, const key_set& keys);
+
+        /** Memory-map a show file, replacing the current show
+         * All frames are checked, play() doesn't need to check anything.
+         * \return 0 if successful, 1 if the file could not be opened or is not a valid show
+         */
+        int load(const std::string& file);
+
+        /** Switch the keyboard to the custom led mode and play the show
+         * \param kbd The opened keyboard, frames are sent to its current profile
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \return Counters, all 0 if no show is loaded
+         */
+        statistics play(keyboard& kbd, const volatile std::sig_atomic_t& stop) const;
+
+        /// Number of frames
+        [[nodiscard]] std::size_t size() const { return header != nullptr ? header->frame_count : 0; }
+        /// Length of the show
+        [[nodiscard]] std::chrono::milliseconds duration() const { return std::chrono::milliseconds(header != nullptr ? header->duration : 0); }
+
+     private:
+        /** Send the runs of a record to the keyboard with set_custom_colors()
+         * \return Number of keys
+         */
+        static std::size_t apply(const uint8_t* runs, std::size_t size, keyboard& kbd);
+        /** Check the runs of a record
+         * \return false if a run is truncated or exceeds max_keys
+         */
+        static bool check(const uint8_t* runs, std::size_t size);
+
+        /// The mapped file, nullptr if no show is loaded
+        std::unique_ptr<mapped_file> mapping;
+        /// Start of the mapped file
+        const uint8_t* data = nullptr;
+        /// The header inside the mapped file
+        const file_header* header = nullptr;
+        /// Offset of the frame after loop_frame, continued with after the loop record
+        std::size_t loop_continue = 0;
+        /// Time of loop_frame
+        uint32_t loop_time = 0;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,34 @@
+#include "mapped_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+rgb_keyboard::mapped_file::mapped_file(const std::string& file, bool sequential) {
+    int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == 0) {
+        length = file_stat.st_size;
+        // empty files can't be mapped
+        if (length == 0) {
+            valid = true;
+        } else {
+            mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            valid = mapping != MAP_FAILED;
+            if (valid)
+                madvise(mapping, length, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+            else
+                mapping = nullptr;
+        }
+    }
+    close(fd);
+}
+
+rgb_keyboard::mapped_file::~mapped_file() {
+    if (mapping != nullptr)
+        munmap(mapping, length);
+}
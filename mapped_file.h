@@ -0,0 +1,44 @@
+// read-only memory mapped files
+#ifndef RGB_KEYBOARD_MAPPED_FILE
+#define RGB_KEYBOARD_MAPPED_FILE
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace rgb_keyboard {
+
+    /**
+     * A read-only memory mapping of a whole file.
+     *
+     * Used by the text parsers, which work on the mapping directly instead of reading lines,
+     * and by the binary file formats (packet programs, pattern libraries, light shows).
+     */
+    class mapped_file {
+     public:
+        /** Map a file, check is_open() for success
+         * \param sequential Tell the kernel that the file is read from start to end, false for random access
+         */
+        explicit mapped_file(const std::string& file, bool sequential = true);
+        ~mapped_file();
+
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        /// Returns false if the file couldn't be opened or mapped
+        [[nodiscard]] bool is_open() const { return valid; }
+        /// Contents of the file
+        [[nodiscard]] std::string_view text() const { return {static_cast<const char*>(mapping), mapping != nullptr ? length : 0}; }
+
+     private:
+        /// Start of the mapping, nullptr for empty files
+        void* mapping = nullptr;
+        /// Length of the file
+        std::size_t length = 0;
+        /// Was the file mapped?
+        bool valid = false;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
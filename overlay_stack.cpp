@@ -0,0 +1,102 @@
+#include "overlay_stack.h"
+
+#include <algorithm>
+
+int rgb_keyboard::overlay_stack::add(const key_framebuffer& colors, const key_framebuffer& displayed, std::chrono::milliseconds period,
+                                     std::chrono::milliseconds ttl, clock::time_point now) {
+    // keep the oldest known color of each key, later overlays see the earlier overlays as underlying colors
+    displayed.for_each([&](int key) {
+        if (underlying.is_set(key))
+            return;
+        if (released.is_set(key)) {
+            // not restored yet, the keyboard still displays the removed overlay
+            underlying.set(key, released.get(key));
+            released.unset(key);
+        } else {
+            underlying.set(key, displayed.get(key));
+        }
+    });
+
+    overlay added{next_id++, colors, period, now, ttl.count() > 0 ? now + ttl : clock::time_point::max()};
+    overlays.push_back(added);
+
+    return added.id;
+}
+
+void rgb_keyboard::overlay_stack::remove(int id) {
+    overlays.erase(std::remove_if(overlays.begin(), overlays.end(), [id](const overlay& o) { return o.id == id; }), overlays.end());
+    release_uncovered();
+}
+
+void rgb_keyboard::overlay_stack::clear() {
+    overlays.clear();
+    release_uncovered();
+}
+
+void rgb_keyboard::overlay_stack::expire(clock::time_point now) {
+    auto expired = std::remove_if(overlays.begin(), overlays.end(), [now](const overlay& o) { return o.expiry <= now; });
+    if (expired == overlays.end())
+        return;
+    overlays.erase(expired, overlays.end());
+    release_uncovered();
+}
+
+void rgb_keyboard::overlay_stack::release_uncovered() {
+    key_set covered;
+    for (const auto& o : overlays)
+        covered = covered | o.colors.keys();
+
+    const key_set uncovered = underlying.keys() - covered;
+    for (int key = 0; key < max_keys; key++) {
+        if (!uncovered.test(key))
+            continue;
+        released.set(key, underlying.get(key));
+        underlying.unset(key);
+    }
+}
+
+void rgb_keyboard::overlay_stack::restored() {
+    released.clear();
+}
+
+rgb_keyboard::overlay_stack::clock::time_point rgb_keyboard::overlay_stack::next_change(clock::time_point now) const {
+    clock::time_point result = clock::time_point::max();
+
+    for (const auto& o : overlays) {
+        result = std::min(result, o.expiry);
+
+        // next start of a blink half period
+        if (o.period.count() > 1) {
+            auto half = o.period / 2;
+            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - o.start);
+            result = std::min(result, o.start + (elapsed / half + 1) * half);
+        }
+    }
+
+    return result;
+}
+
+rgb_keyboard::key_framebuffer rgb_keyboard::overlay_stack::compose(const key_framebuffer& base, clock::time_point now) const {
+    // restore overlaid keys that are not part of the custom pattern
+    key_framebuffer result = released;
+    result.merge(underlying);
+    result.merge(base);
+
+    for (const auto& o : overlays) {
+        if (o.visible(now))
+            result.merge(o.colors);
+    }
+
+    return result;
+}
+
+bool rgb_keyboard::overlay_stack::overlay::visible(clock::time_point now) const {
+    if (now >= expiry)
+        return false;
+    if (period.count() <= 1)
+        return true;
+
+    auto half = period / 2;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
+    return (elapsed / half) % 2 == 0;
+}
@@ -0,0 +1,88 @@
+// temporary key colors on top of the custom pattern
+#ifndef RGB_KEYBOARD_OVERLAY_STACK
+#define RGB_KEYBOARD_OVERLAY_STACK
+
+#include <chrono>
+#include <vector>
+
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class stores overlays: temporary key colors shown on top of the custom pattern.
+     *
+     * Each overlay can blink (shown for the first half of each period) and expire after a time to live.
+     * Overlays added later are shown on top of earlier ones. When an overlay is hidden or removed,
+     * its keys show the colors below it again: lower overlays, the custom pattern, or the color the
+     * key had when the overlay was added. That color is only kept while an overlay covers the key,
+     * after it was restored once, a new overlay stores the color displayed then.
+     */
+    class overlay_stack {
+     public:
+        /// Clock used for blinking and expiry
+        using clock = std::chrono::steady_clock;
+
+        /** Add an overlay on top of all others
+         * \param colors The keys and colors of the overlay
+         * \param displayed The colors the keyboard displays for the overlay keys, restored when the overlay is removed
+         * \param period Blink period, 0 for a steady overlay
+         * \param ttl Time to live, 0 for an overlay that is only removed with remove()
+         * \param now Start of the first blink period
+         * \return Id of the overlay
+         */
+        int add(const key_framebuffer& colors, const key_framebuffer& displayed, std::chrono::milliseconds period, std::chrono::milliseconds ttl,
+                clock::time_point now = clock::now());
+        /// Remove an overlay
+        void remove(int id);
+        /// Remove all overlays
+        void clear();
+        /// Remove all overlays whose time to live has passed
+        void expire(clock::time_point now = clock::now());
+
+        /// Returns true if there are no overlays
+        [[nodiscard]] bool empty() const { return overlays.empty(); }
+        /** Get the next time an overlay changes (blinks or expires)
+         * \return clock::time_point::max() if no overlay will change
+         */
+        [[nodiscard]] clock::time_point next_change(clock::time_point now = clock::now()) const;
+
+        /** Compose the colors to display
+         * \param base The custom pattern below all overlays
+         * \param now Time used for blinking
+         * \return base with all visible overlays applied
+         */
+        [[nodiscard]] key_framebuffer compose(const key_framebuffer& base, clock::time_point now = clock::now()) const;
+        /// Call this when the result of compose() is displayed, keys whose last overlay was removed are no longer restored
+        void restored();
+
+     private:
+        /// An overlay
+        struct overlay {
+            int id;
+            key_framebuffer colors;
+            std::chrono::milliseconds period;
+            clock::time_point start;
+            /// clock::time_point::max() if the overlay does not expire
+            clock::time_point expiry;
+
+            /// Is the overlay shown at this time?
+            [[nodiscard]] bool visible(clock::time_point now) const;
+        };
+
+        /// All overlays, the last one is on top
+        std::vector<overlay> overlays;
+        /// Move the keys that are no longer covered by an overlay from underlying to released
+        void release_uncovered();
+
+        /// Colors of overlaid keys that are not part of the custom pattern, from the time an overlay was added
+        key_framebuffer underlying;
+        /// Underlying colors of keys whose last overlay was removed, restored until restored() is called
+        key_framebuffer released;
+        /// Id of the next overlay
+        int next_id = 1;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
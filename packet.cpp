@@ -0,0 +1,36 @@
+#include "packet.h"
+
+rgb_keyboard::commands rgb_keyboard::packet_command(const packet& data) {
+    return static_cast<commands>(data[offset_command]);
+}
+
+uint32_t rgb_keyboard::packet_address(const packet& data) {
+    return data[offset_address] | (data[offset_address + 1] << 8) | (data[offset_address + 2] << 16);
+}
+
+bool rgb_keyboard::is_write_packet(const packet& data) {
+    switch (packet_command(data)) {
+        case commands::write_profile:
+        case commands::write_settings:
+        case commands::write_keymap:
+        case commands::write_macros:
+        case commands::write_custom:
+            return true;
+        default:
+            return false;
+    }
+}
+
+uint16_t rgb_keyboard::calculate_checksum(const packet& data) {
+    uint16_t checksum = 0;
+    for (int i = offset_command; i < packet_length; i++)
+        checksum += data[i];
+
+    return checksum;
+}
+
+void rgb_keyboard::update_checksum(packet& data) {
+    uint16_t checksum = calculate_checksum(data);
+    data[offset_checksum] = checksum & 0xff;
+    data[offset_checksum + 1] = checksum >> 8;
+}
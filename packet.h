@@ -0,0 +1,59 @@
+// usb data packet type
+#ifndef RGB_KEYBOARD_PACKET
+#define RGB_KEYBOARD_PACKET
+
+#include <array>
+#include <cstdint>
+
+namespace rgb_keyboard {
+
+    /// Length of every data packet sent to the keyboard
+    constexpr int packet_length = 64;
+
+    /** A single data packet as sent to the keyboard
+     *
+     * Layout:
+     * - [0] always 0x04
+     * - [1..2] checksum, 16 bit sum of bytes 3-63 (little endian)
+     * - [3] command
+     * - [4] payload length
+     * - [5..7] address the payload is written to/read from (little endian)
+     * - [8..63] payload
+     */
+    using packet = std::array<uint8_t, packet_length>;
+
+    /// Byte offsets of the fields inside a packet
+    enum packet_offsets { offset_checksum = 1, offset_command = 3, offset_length = 4, offset_address = 5, offset_payload = 8 };
+
+    /// Maximum length of the payload of a single packet
+    constexpr int max_payload_length = packet_length - offset_payload;
+
+    /** Commands (byte 3) understood by the keyboard
+     * Each read command reads from the memory region of the following write command.
+     */
+    enum struct commands : uint8_t {
+        start = 0x01,
+        end = 0x02,
+        read_profile = 0x03,
+        write_profile = 0x04,
+        read_settings = 0x05,
+        write_settings = 0x06,
+        write_keymap = 0x08,
+        write_macros = 0x0a,
+        write_custom = 0x11
+    };
+
+    /// Get the command of a packet
+    commands packet_command(const packet& data);
+    /// Get the address of a packet
+    uint32_t packet_address(const packet& data);
+    /// Returns true if the packet writes its payload to the keyboard memory
+    bool is_write_packet(const packet& data);
+    /// Calculate the checksum of a packet
+    uint16_t calculate_checksum(const packet& data);
+    /// Calculate the checksum of a packet and store it in the packet
+    void update_checksum(packet& data);
+
+}  // namespace rgb_keyboard
+
+#endif
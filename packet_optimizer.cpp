@@ -0,0 +1,217 @@
+#include "packet_optimizer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+
+namespace {
+    bool is_command(const rgb_keyboard::packet& data, rgb_keyboard::commands command) {
+        return rgb_keyboard::packet_command(data) == command;
+    }
+
+    int payload_length(const rgb_keyboard::packet& data) {
+        return std::min<int>(data[rgb_keyboard::offset_length], rgb_keyboard::max_payload_length);
+    }
+
+    // can writes of this command be merged?
+    // only commands whose captured multi-byte packets all carry the sum checksum, custom led writes
+    // use a per-address checksum and are never sent with more than one key
+    bool is_mergeable(rgb_keyboard::commands command) {
+        return command == rgb_keyboard::commands::write_profile || command == rgb_keyboard::commands::write_keymap;
+    }
+}  // namespace
+
+rgb_keyboard::packet_optimizer::statistics rgb_keyboard::packet_optimizer::optimize(std::vector<packet>& packets, const protocol_simulator& known) {
+    statistics stats;
+    stats.packets_in = packets.size();
+
+    // apply all passes to a copy
+    std::vector<packet> result = packets;
+    stats.brackets_removed += merge_batches(result);
+    stats.overwritten_removed += remove_overwritten(result);
+    stats.noops_removed += remove_noops(result, known);
+    stats.brackets_removed += remove_empty_batches(result);
+    stats.merged += merge_writes(result);
+
+    // only use the result if it has the same effect
+    stats.equivalent = protocol_simulator::equivalent(packets, result, known);
+    if (stats.equivalent)
+        packets = std::move(result);
+
+    stats.packets_out = packets.size();
+    return stats;
+}
+
+std::size_t rgb_keyboard::packet_optimizer::merge_batches(std::vector<packet>& packets) {
+    std::vector<packet> result;
+    result.reserve(packets.size());
+
+    for (std::size_t i = 0; i < packets.size(); i++) {
+        // data_end, data_start → nothing
+        if (i + 1 < packets.size() && is_command(packets[i], commands::end) && is_command(packets[i + 1], commands::start)) {
+            i++;
+            continue;
+        }
+        result.push_back(packets[i]);
+    }
+
+    std::size_t removed = packets.size() - result.size();
+    packets = std::move(result);
+    return removed;
+}
+
+std::size_t rgb_keyboard::packet_optimizer::remove_overwritten(std::vector<packet>& packets) {
+    std::vector<bool> keep(packets.size(), true);
+
+    // addresses written later in the current batch
+    std::unordered_set<uint64_t> written;
+    // is the current batch ended? (scanning backwards, only ended batches are applied)
+    bool applied = false;
+
+    for (std::size_t i = packets.size(); i-- > 0;) {
+        const packet& data = packets[i];
+
+        if (is_command(data, commands::end)) {
+            applied = true;
+            written.clear();
+            continue;
+        }
+        if (is_command(data, commands::start)) {
+            applied = false;
+            written.clear();
+            continue;
+        }
+        // writes outside of a batch and reads are left as they are
+        if (!applied || !is_write_packet(data)) {
+            written.clear();
+            continue;
+        }
+
+        // is every byte overwritten later?
+        int length = payload_length(data);
+        uint64_t region = static_cast<uint64_t>(packet_command(data)) << 32;
+        uint32_t address = packet_address(data);
+        bool overwritten = true;
+        for (int j = 0; j < length; j++) {
+            if (!written.insert(region | (address + j)).second)
+                continue;
+            overwritten = false;
+        }
+
+        keep[i] = !overwritten;
+    }
+
+    std::vector<packet> result;
+    result.reserve(packets.size());
+    for (std::size_t i = 0; i < packets.size(); i++) {
+        if (keep[i])
+            result.push_back(packets[i]);
+    }
+
+    std::size_t removed = packets.size() - result.size();
+    packets = std::move(result);
+    return removed;
+}
+
+std::size_t rgb_keyboard::packet_optimizer::remove_noops(std::vector<packet>& packets, const protocol_simulator& known) {
+    protocol_simulator state = known;
+
+    std::vector<packet> result;
+    result.reserve(packets.size());
+    for (const auto& data : packets) {
+        if (state.is_noop(data))
+            continue;
+
+        state.process(data);
+        result.push_back(data);
+    }
+
+    std::size_t removed = packets.size() - result.size();
+    packets = std::move(result);
+    return removed;
+}
+
+std::size_t rgb_keyboard::packet_optimizer::remove_empty_batches(std::vector<packet>& packets) {
+    std::vector<packet> result;
+    result.reserve(packets.size());
+
+    for (std::size_t i = 0; i < packets.size(); i++) {
+        // data_start, data_end → nothing
+        if (i + 1 < packets.size() && is_command(packets[i], commands::start) && is_command(packets[i + 1], commands::end)) {
+            i++;
+            continue;
+        }
+        result.push_back(packets[i]);
+    }
+
+    std::size_t removed = packets.size() - result.size();
+    packets = std::move(result);
+    return removed;
+}
+
+std::size_t rgb_keyboard::packet_optimizer::merge_writes(std::vector<packet>& packets) {
+    std::vector<packet> result;
+    result.reserve(packets.size());
+
+    bool batch_open = false;
+    std::size_t i = 0;
+    while (i < packets.size()) {
+        if (is_command(packets[i], commands::start))
+            batch_open = true;
+        else if (is_command(packets[i], commands::end))
+            batch_open = false;
+
+        // find a run of mergeable writes of the same command inside of a batch
+        const commands command = packet_command(packets[i]);
+        std::size_t run_end = i;
+        while (batch_open && is_mergeable(command) && run_end < packets.size() && is_command(packets[run_end], command))
+            run_end++;
+
+        if (run_end - i < 2) {
+            result.push_back(packets[i]);
+            i++;
+            continue;
+        }
+
+        // sort run by address, this is only allowed if no writes overlap
+        std::vector<packet> run(packets.begin() + i, packets.begin() + run_end);
+        std::stable_sort(run.begin(), run.end(), [](const packet& a, const packet& b) { return packet_address(a) < packet_address(b); });
+        bool overlapping = false;
+        for (std::size_t j = 1; j < run.size(); j++) {
+            if (packet_address(run[j - 1]) + payload_length(run[j - 1]) > packet_address(run[j]))
+                overlapping = true;
+        }
+        if (overlapping)
+            run.assign(packets.begin() + i, packets.begin() + run_end);
+
+        // merge writes to adjacent addresses
+        std::size_t j = 0;
+        while (j < run.size()) {
+            packet merged = run[j];
+            int length = payload_length(merged);
+            std::size_t k = j + 1;
+            while (k < run.size() && packet_address(run[k]) == packet_address(merged) + length &&
+                   length + payload_length(run[k]) <= max_payload_length) {
+                std::copy_n(run[k].begin() + offset_payload, payload_length(run[k]), merged.begin() + offset_payload + length);
+                length += payload_length(run[k]);
+                k++;
+            }
+
+            // single packets are kept unmodified
+            if (k - j > 1) {
+                merged[offset_length] = length;
+                std::fill(merged.begin() + offset_payload + length, merged.end(), 0);
+                update_checksum(merged);
+            }
+
+            result.push_back(merged);
+            j = k;
+        }
+
+        i = run_end;
+    }
+
+    std::size_t removed = packets.size() - result.size();
+    packets = std::move(result);
+    return removed;
+}
@@ -0,0 +1,73 @@
+// peephole optimizer for packet sequences
+#ifndef RGB_KEYBOARD_PACKET_OPTIMIZER
+#define RGB_KEYBOARD_PACKET_OPTIMIZER
+
+#include <cstddef>
+#include <vector>
+
+#include "packet.h"
+#include "protocol_simulator.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class removes redundant packets from a packet sequence.
+     *
+     * The following passes are applied in order:
+     * 1. data_end directly followed by data_start is removed, merging adjacent batches
+     * 2. writes that are completely overwritten later in the same batch are removed
+     * 3. writes that don't change the known keyboard memory are removed
+     * 4. empty batches (data_start directly followed by data_end) are removed
+     * 5. runs of profile or keymap writes are sorted by address and adjacent writes are merged into one packet
+     *
+     * Custom led writes are never merged, the keyboard expects one key per packet with a checksum
+     * that depends on the address (see keyboard::write_custom()).
+     *
+     * The result is checked with protocol_simulator, if it is not equivalent
+     * to the input the input is left unchanged.
+     */
+    class packet_optimizer {
+     public:
+        /// Packet counts before and after optimizing
+        struct statistics {
+            /// Number of packets before optimizing
+            std::size_t packets_in = 0;
+            /// Number of packets after optimizing
+            std::size_t packets_out = 0;
+            /// Number of removed data_start and data_end packets
+            std::size_t brackets_removed = 0;
+            /// Number of removed overwritten writes
+            std::size_t overwritten_removed = 0;
+            /// Number of removed writes that don't change anything
+            std::size_t noops_removed = 0;
+            /// Number of writes saved by merging
+            std::size_t merged = 0;
+            /// Was the result equivalent on the protocol simulator? (if not, the input was kept)
+            bool equivalent = true;
+
+            /// Number of saved packets
+            [[nodiscard]] std::size_t saved() const { return packets_in - packets_out; }
+        };
+
+        /** Optimize a packet sequence in place
+         * \param packets The packets to optimize
+         * \param known The state of the keyboard before the packets are sent
+         */
+        static statistics optimize(std::vector<packet>& packets, const protocol_simulator& known = {});
+
+     private:
+        /// Pass 1
+        static std::size_t merge_batches(std::vector<packet>& packets);
+        /// Pass 2
+        static std::size_t remove_overwritten(std::vector<packet>& packets);
+        /// Pass 3
+        static std::size_t remove_noops(std::vector<packet>& packets, const protocol_simulator& known);
+        /// Pass 4
+        static std::size_t remove_empty_batches(std::vector<packet>& packets);
+        /// Pass 5
+        static std::size_t merge_writes(std::vector<packet>& packets);
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
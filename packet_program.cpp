@@ -0,0 +1,81 @@
+#include "packet_program.h"
+
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+rgb_keyboard::packet_program::packet_program(models model, int profile, std::vector<packet> packets)
+    : model(model), profile(profile), packets(std::move(packets)) {}
+
+void rgb_keyboard::packet_program::unmap() {
+    mapping.reset();
+    mapped_packets = nullptr;
+    mapped_count = 0;
+}
+
+int rgb_keyboard::packet_program::save(const std::string& file) const {
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return 1;
+    }
+
+    // prepare header
+    file_header header{};
+    std::memcpy(header.magic, "RGBKPROG", sizeof(header.magic));
+    header.version = format_version;
+    header.header_size = sizeof(file_header);
+    header.packet_size = packet_length;
+    header.model = model;
+    header.profile = profile;
+    header.packet_count = size();
+
+    // write header and packets
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data()), size() * packet_length);
+
+    return out.good() ? 0 : 1;
+}
+
+int rgb_keyboard::packet_program::load(const std::string& file) {
+    unmap();
+    packets.clear();
+
+    auto loaded_mapping = std::make_unique<mapped_file>(file);
+    if (!loaded_mapping->is_open() || loaded_mapping->text().size() < sizeof(file_header)) {
+        return 1;
+    }
+
+    // check header
+    const auto* loaded_data = reinterpret_cast<const uint8_t*>(loaded_mapping->text().data());
+    const auto* header = reinterpret_cast<const file_header*>(loaded_data);
+    std::size_t length = loaded_mapping->text().size();
+    if (std::memcmp(header->magic, "RGBKPROG", sizeof(header->magic)) != 0 || header->version != format_version ||
+        header->header_size != sizeof(file_header) || header->packet_size != packet_length ||
+        length < sizeof(file_header) + static_cast<std::size_t>(header->packet_count) * packet_length) {
+        return 1;
+    }
+
+    mapping = std::move(loaded_mapping);
+    model = header->model;
+    profile = header->profile;
+    mapped_packets = reinterpret_cast<const packet*>(loaded_data + sizeof(file_header));
+    mapped_count = header->packet_count;
+
+    return 0;
+}
+
+rgb_keyboard::packet_program::models rgb_keyboard::packet_program::get_model() const {
+    return model;
+}
+
+int rgb_keyboard::packet_program::get_profile() const {
+    return profile;
+}
+
+std::size_t rgb_keyboard::packet_program::size() const {
+    return mapping != nullptr ? mapped_count : packets.size();
+}
+
+const rgb_keyboard::packet* rgb_keyboard::packet_program::data() const {
+    return mapping != nullptr ? mapped_packets : packets.data();
+}
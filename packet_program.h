@@ -0,0 +1,107 @@
+// compiled packet programs
+#ifndef RGB_KEYBOARD_PACKET_PROGRAM
+#define RGB_KEYBOARD_PACKET_PROGRAM
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+#include "packet.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class represents a compiled packet program.
+     *
+     * A packet program is the exact sequence of data packets that a set of
+     * write_*() calls sends to the keyboard. It is created by capturing the
+     * packets (see keyboard::begin_capture()) and can be stored in a file and
+     * replayed with keyboard::write_program() without parsing any configuration.
+     *
+     * File layout (little endian):
+     * - 64 byte header (see file_header)
+     * - packet_count packets of 64 bytes each, starting at offset 64
+     *
+     * Loaded files are memory-mapped, the packets are sent directly from the mapping.
+     */
+    class packet_program {
+     public:
+        /// Current file format version
+        static constexpr uint16_t format_version = 1;
+
+        /// Target keyboard model of a program, determines how packets are transferred
+        enum struct models : uint16_t { standard = 0, ajazzak33 = 1 };
+
+        /// The file header, exactly one packet long so that the packets stay aligned
+        struct file_header {
+            /// Always "RGBKPROG"
+            char magic[8];
+            /// File format version
+            uint16_t version;
+            /// Size of this header in bytes
+            uint16_t header_size;
+            /// Size of each packet in bytes
+            uint16_t packet_size;
+            /// Target keyboard model
+            models model;
+            /// Profile (1-3) the settings were compiled for
+            uint8_t profile;
+            /// Reserved, always 0
+            uint8_t reserved_0[3];
+            /// Number of packets following the header
+            uint32_t packet_count;
+            /// Reserved, always 0
+            uint8_t reserved_1[40];
+        };
+        static_assert(sizeof(file_header) == packet_length, "header must be one packet long");
+
+        packet_program() = default;
+        /// Create a program from captured packets
+        packet_program(models model, int profile, std::vector<packet> packets);
+
+        packet_program(const packet_program&) = delete;
+        packet_program& operator=(const packet_program&) = delete;
+
+        /** Write the program to a file
+         * \return 0 if successful, 1 if the file could not be written
+         */
+        int save(const std::string& file) const;
+        /** Memory-map a program from a file, replacing the current contents
+         * \return 0 if successful, 1 if the file could not be opened or is not a valid program
+         */
+        int load(const std::string& file);
+
+        /// Target keyboard model
+        [[nodiscard]] models get_model() const;
+        /// Profile the program was compiled for
+        [[nodiscard]] int get_profile() const;
+        /// Number of packets
+        [[nodiscard]] std::size_t size() const;
+        /// Pointer to the first packet
+        [[nodiscard]] const packet* data() const;
+
+     private:
+        /// Unmap the currently loaded file
+        void unmap();
+
+        /// Target keyboard model
+        models model = models::standard;
+        /// Profile (1-3)
+        int profile = 1;
+        /// Packets of a program that was not loaded from a file
+        std::vector<packet> packets;
+
+        /// The mapped file, nullptr if not loaded from a file
+        std::unique_ptr<mapped_file> mapping;
+        /// Packets inside the mapped file
+        const packet* mapped_packets = nullptr;
+        /// Number of packets inside the mapped file
+        std::size_t mapped_count = 0;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
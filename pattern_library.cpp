@@ -0,0 +1,156 @@
+#include "pattern_library.h"
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "static_table.h"
+
+static_assert(sizeof(rgb_keyboard::color) == 3, "colors are stored as 3 bytes");
+
+void rgb_keyboard::pattern_library::unmap() {
+    mapping.reset();
+    data = nullptr;
+    mapping_length = 0;
+    header = nullptr;
+    buckets = nullptr;
+    entries = nullptr;
+}
+
+int rgb_keyboard::pattern_library::save(const std::string& file, const std::vector<std::pair<std::string, key_framebuffer>>& patterns) {
+    // at most half of the buckets are used
+    uint32_t bucket_count = 1;
+    while (bucket_count < 2 * patterns.size())
+        bucket_count *= 2;
+
+    std::vector<uint32_t> bucket_table(bucket_count, 0);
+    std::vector<entry> entry_table(patterns.size());
+    std::vector<uint8_t> data;
+    uint32_t data_start = sizeof(file_header) + bucket_count * sizeof(uint32_t) + patterns.size() * sizeof(entry);
+
+    for (std::size_t i = 0; i < patterns.size(); i++) {
+        const auto& [name, colors] = patterns[i];
+        entry& e = entry_table[i];
+        e.hash = name_hash(name);
+
+        // insert into hash table
+        uint32_t bucket = e.hash & (bucket_count - 1);
+        while (bucket_table[bucket] != 0) {
+            const auto& other = patterns[bucket_table[bucket] - 1].first;
+            if (other == name)
+                throw std::invalid_argument("Duplicate pattern name: " + name);
+            bucket = (bucket + 1) & (bucket_count - 1);
+        }
+        bucket_table[bucket] = i + 1;
+
+        // name
+        e.name_offset = data_start + data.size();
+        e.name_length = name.size();
+        data.insert(data.end(), name.begin(), name.end());
+
+        // key indices, then colors
+        e.data_offset = data_start + data.size();
+        e.key_count = colors.count();
+        colors.for_each([&](int key) { data.push_back(key); });
+        colors.for_each([&](int key) {
+            color value = colors.get(key);
+            data.insert(data.end(), value.begin(), value.end());
+        });
+    }
+
+    std::ofstream out(file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return 1;
+    }
+
+    // prepare header
+    file_header header{};
+    std::memcpy(header.magic, "RGBKPACK", sizeof(header.magic));
+    header.version = format_version;
+    header.header_size = sizeof(file_header);
+    header.entry_size = sizeof(entry);
+    header.pattern_count = patterns.size();
+    header.bucket_count = bucket_count;
+
+    // write header, index and data
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(bucket_table.data()), bucket_table.size() * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(entry_table.data()), entry_table.size() * sizeof(entry));
+    out.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+    return out.good() ? 0 : 1;
+}
+
+int rgb_keyboard::pattern_library::load(const std::string& file) {
+    unmap();
+
+    // patterns are looked up by name, not read in order
+    auto loaded_mapping = std::make_unique<mapped_file>(file, false);
+    if (!loaded_mapping->is_open() || loaded_mapping->text().size() < sizeof(file_header)) {
+        return 1;
+    }
+
+    // check header and index size, pattern data is checked when it is used
+    const auto* loaded_data = reinterpret_cast<const uint8_t*>(loaded_mapping->text().data());
+    const auto* loaded = reinterpret_cast<const file_header*>(loaded_data);
+    std::size_t length = loaded_mapping->text().size();
+    std::size_t index_end = sizeof(file_header) + static_cast<std::size_t>(loaded->bucket_count) * sizeof(uint32_t) +
+                            static_cast<std::size_t>(loaded->pattern_count) * sizeof(entry);
+    if (std::memcmp(loaded->magic, "RGBKPACK", sizeof(loaded->magic)) != 0 || loaded->version != format_version ||
+        loaded->header_size != sizeof(file_header) || loaded->entry_size != sizeof(entry) || loaded->bucket_count == 0 ||
+        (loaded->bucket_count & (loaded->bucket_count - 1)) != 0 || loaded->bucket_count <= loaded->pattern_count || length < index_end) {
+        return 1;
+    }
+
+    mapping = std::move(loaded_mapping);
+    data = loaded_data;
+    mapping_length = length;
+    header = loaded;
+    buckets = reinterpret_cast<const uint32_t*>(data + sizeof(file_header));
+    entries = reinterpret_cast<const entry*>(buckets + header->bucket_count);
+
+    return 0;
+}
+
+bool rgb_keyboard::pattern_library::find(std::string_view name, pattern& result) const {
+    if (mapping == nullptr)
+        return false;
+
+    uint64_t hash = name_hash(name);
+    uint32_t mask = header->bucket_count - 1;
+
+    // linear probing, there is always an empty bucket
+    for (uint32_t bucket = hash & mask, probes = 0; probes < header->bucket_count; bucket = (bucket + 1) & mask, probes++) {
+        uint32_t index = buckets[bucket];
+        if (index == 0 || index > header->pattern_count)
+            return false;
+
+        const entry& e = entries[index - 1];
+        if (e.hash != hash || this->name(index - 1) != name)
+            continue;
+
+        // the pattern must be inside the file
+        std::size_t end = static_cast<std::size_t>(e.data_offset) + static_cast<std::size_t>(e.key_count) * 4;
+        if (end > mapping_length || e.key_count > static_cast<uint32_t>(max_keys))
+            return false;
+
+        result.keys = data + e.data_offset;
+        result.colors = reinterpret_cast<const color*>(data + e.data_offset + e.key_count);
+        result.count = e.key_count;
+        return true;
+    }
+
+    return false;
+}
+
+std::size_t rgb_keyboard::pattern_library::size() const {
+    return mapping != nullptr ? header->pattern_count : 0;
+}
+
+std::string_view rgb_keyboard::pattern_library::name(std::size_t i) const {
+    const entry& e = entries[i];
+    if (static_cast<std::size_t>(e.name_offset) + e.name_length > mapping_length)
+        return {};
+
+    return {reinterpret_cast<const char*>(data + e.name_offset), e.name_length};
+}
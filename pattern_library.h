@@ -0,0 +1,129 @@
+// memory-mapped libraries of custom led patterns
+#ifndef RGB_KEYBOARD_PATTERN_LIBRARY
+#define RGB_KEYBOARD_PATTERN_LIBRARY
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "key_framebuffer.h"
+#include "mapped_file.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class represents a pattern library: many named custom led patterns in one file.
+     *
+     * The patterns are stored as key index and color arrays that can be passed to
+     * keyboard::set_custom_colors() directly, a hash table finds a pattern by name.
+     * Loaded files are memory-mapped, nothing is parsed or copied when a pattern is used.
+     *
+     * File layout (little endian, all offsets from the start of the file):
+     * - 64 byte header (see file_header)
+     * - bucket_count 32 bit buckets, each is 0 (empty) or entry index + 1, linear probing
+     * - pattern_count entries (see entry)
+     * - names and pattern data: key indices (1 byte per key), followed by colors (3 bytes per key)
+     */
+    class pattern_library {
+     public:
+        /// Current file format version
+        static constexpr uint16_t format_version = 1;
+
+        /// The file header
+        struct file_header {
+            /// Always "RGBKPACK"
+            char magic[8];
+            /// File format version
+            uint16_t version;
+            /// Size of this header in bytes
+            uint16_t header_size;
+            /// Size of each entry in bytes
+            uint16_t entry_size;
+            /// Reserved, always 0
+            uint16_t reserved_0;
+            /// Number of patterns
+            uint32_t pattern_count;
+            /// Number of hash buckets, a power of two
+            uint32_t bucket_count;
+            /// Reserved, always 0
+            uint8_t reserved_1[40];
+        };
+        static_assert(sizeof(file_header) == 64, "header must be 64 bytes long");
+
+        /// Index entry of a pattern
+        struct entry {
+            /// Hash of the name
+            uint64_t hash;
+            /// Offset of the name
+            uint32_t name_offset;
+            /// Length of the name
+            uint32_t name_length;
+            /// Offset of the key indices, the colors follow directly
+            uint32_t data_offset;
+            /// Number of keys
+            uint32_t key_count;
+            /// Reserved, always 0
+            uint8_t reserved[8];
+        };
+        static_assert(sizeof(entry) == 32, "entry must be 32 bytes long");
+
+        /// A pattern inside the library
+        struct pattern {
+            /// Key indices
+            const uint8_t* keys;
+            /// One color for each key
+            const color* colors;
+            /// Number of keys
+            std::size_t count;
+        };
+
+        pattern_library() = default;
+
+        pattern_library(const pattern_library&) = delete;
+        pattern_library& operator=(const pattern_library&) = delete;
+
+        /** Write a library file
+         * \param patterns Name and colors of each pattern, names must be unique
+         * \return 0 if successful, 1 if the file could not be written
+         * \throws std::invalid_argument if a name is used twice
+         */
+        static int save(const std::string& file, const std::vector<std::pair<std::string, key_framebuffer>>& patterns);
+        /** Memory-map a library file, replacing the current contents
+         * \return 0 if successful, 1 if the file could not be opened or is not a valid library
+         */
+        int load(const std::string& file);
+
+        /** Find a pattern by name
+         * \return true if the pattern exists
+         */
+        bool find(std::string_view name, pattern& result) const;
+        /// Number of patterns
+        [[nodiscard]] std::size_t size() const;
+        /// Name of the pattern with index i (in the order they were stored)
+        [[nodiscard]] std::string_view name(std::size_t i) const;
+
+     private:
+        /// Unmap the currently loaded file
+        void unmap();
+
+        /// The mapped file, nullptr if no file is loaded
+        std::unique_ptr<mapped_file> mapping;
+        /// Start of the mapped file
+        const uint8_t* data = nullptr;
+        /// Length of the mapped file
+        std::size_t mapping_length = 0;
+        /// The header inside the mapped file
+        const file_header* header = nullptr;
+        /// Buckets inside the mapped file
+        const uint32_t* buckets = nullptr;
+        /// Entries inside the mapped file
+        const entry* entries = nullptr;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
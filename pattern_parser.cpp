@@ -0,0 +1,164 @@
+#include "pattern_parser.h"
+
+#include <array>
+#include <stdexcept>
+
+#include "key_selector.h"
+#include "rgb_keyboard.h"
+
+namespace {
+    // value of each hex digit, 0xff for all other characters
+    constexpr std::array<uint8_t, 256> make_hex_table() {
+        std::array<uint8_t, 256> table{};
+        for (auto& value : table)
+            value = 0xff;
+        for (int c = '0'; c <= '9'; c++)
+            table[c] = c - '0';
+        for (int c = 'a'; c <= 'f'; c++)
+            table[c] = c - 'a' + 10;
+        for (int c = 'A'; c <= 'F'; c++)
+            table[c] = c - 'A' + 10;
+        return table;
+    }
+    constexpr std::array<uint8_t, 256> hex_table = make_hex_table();
+
+    // decode rrggbb, false if value isn't exactly 6 hex digits
+    bool parse_color(std::string_view value, rgb_keyboard::color& result) {
+        if (value.size() != 6)
+            return false;
+
+        uint8_t digits[6];
+        uint8_t invalid = 0;
+        for (int i = 0; i < 6; i++) {
+            digits[i] = hex_table[static_cast<uint8_t>(value[i])];
+            invalid |= digits[i];
+        }
+        // valid digits are < 16, 0xff has the high bit set
+        if (invalid & 0x80)
+            return false;
+
+        result = {uint8_t(digits[0] << 4 | digits[1]), uint8_t(digits[2] << 4 | digits[3]), uint8_t(digits[4] << 4 | digits[5])};
+        return true;
+    }
+
+    // parser state shared by both syntaxes
+    struct parser {
+        rgb_keyboard::key_framebuffer& colors;
+        std::vector<rgb_keyboard::parse_diagnostic>& diagnostics;
+        // start of the text and of the current line, for columns
+        const char* line_start;
+        std::size_t line;
+
+        void error(const char* position, std::string message) {
+            diagnostics.push_back({line, std::size_t(position - line_start) + 1, std::move(message)});
+        }
+
+        // store one entry, key and value point into the text
+        void entry(std::string_view key, std::string_view value) {
+            key = rgb_keyboard::trim(key);
+            value = rgb_keyboard::trim(value);
+
+            rgb_keyboard::color rgb;
+            if (!parse_color(value, rgb)) {
+                error(value.data(), "Expected color rrggbb, got '" + std::string(value) + "'");
+                return;
+            }
+            if (key.empty()) {
+                error(key.data(), "Missing key name");
+                return;
+            }
+
+            // plain key names are resolved directly, everything else is a key selector
+            int index = rgb_keyboard::keyboard::get_led_key_index(key);
+            if (index >= 0) {
+                colors.set(index, rgb);
+                return;
+            }
+
+            rgb_keyboard::key_set keys;
+            try {
+                keys = rgb_keyboard::parse_key_selector(key);
+            } catch (std::invalid_argument& e) {
+                error(key.data(), e.what());
+                return;
+            }
+            if (keys.count() == 0) {
+                error(key.data(), "Key selector '" + std::string(key) + "' selects no keys");
+                return;
+            }
+            colors.set(keys, rgb);
+        }
+
+        // pattern file: key<TAB>rrggbb lines
+        void parse_file(std::string_view text) {
+            while (!text.empty()) {
+                std::size_t end = text.find('\n');
+                std::string_view current = text.substr(0, end);
+                text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+                if (!current.empty() && current.back() == '\r')
+                    current.remove_suffix(1);
+
+                // fast path for the common "name<TAB>rrggbb" line, everything else goes through entry()
+                const std::size_t key_length = current.size() - 7;
+                rgb_keyboard::color rgb;
+                int index;
+                if (current.size() > 7 && current[key_length] == '\t' && current[0] != '#' && current[0] != ' ' && current[0] != '\t' &&
+                    current[key_length - 1] != ' ' && current[key_length - 1] != '\t' && parse_color(current.substr(key_length + 1), rgb) &&
+                    (index = rgb_keyboard::keyboard::get_led_key_index(current.substr(0, key_length))) >= 0) {
+                    colors.set(index, rgb);
+                } else if (!rgb_keyboard::trim(current).empty() && current[0] != '#') {
+                    std::size_t tab = current.find('\t');
+                    if (tab == std::string_view::npos)
+                        error(current.data() + current.size(), "Expected key<TAB>rrggbb");
+                    else
+                        entry(current.substr(0, tab), current.substr(tab + 1));
+                }
+
+                line++;
+                line_start = text.data();
+            }
+        }
+
+        // commandline: key=rrggbb; entries
+        void parse_keys(std::string_view text) {
+            while (!text.empty()) {
+                std::size_t end = text.find(';');
+                std::string_view current = text.substr(0, end);
+                text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+                if (rgb_keyboard::trim(current).empty())
+                    continue;
+
+                std::size_t equals = current.find('=');
+                if (equals == std::string_view::npos)
+                    error(current.data() + current.size(), "Expected key=rrggbb");
+                else
+                    entry(current.substr(0, equals), current.substr(equals + 1));
+            }
+        }
+    };
+}  // namespace
+
+std::vector<rgb_keyboard::parse_diagnostic> rgb_keyboard::parse_pattern(std::string_view text, pattern_syntax syntax, key_framebuffer& colors) {
+    std::vector<parse_diagnostic> diagnostics;
+    parser state{colors, diagnostics, text.data(), 1};
+
+    if (syntax == pattern_syntax::file)
+        state.parse_file(text);
+    else
+        state.parse_keys(text);
+
+    return diagnostics;
+}
+
+std::string rgb_keyboard::format_diagnostics(std::string_view source, const std::vector<parse_diagnostic>& diagnostics) {
+    std::string result;
+    for (const auto& diagnostic : diagnostics) {
+        if (!result.empty())
+            result += '\n';
+        result.append(source);
+        result += ':' + std::to_string(diagnostic.line) + ':' + std::to_string(diagnostic.column) + ": " + diagnostic.message;
+    }
+    return result;
+}
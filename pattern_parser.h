@@ -0,0 +1,60 @@
+// single pass parser for custom patterns
+#ifndef RGB_KEYBOARD_PATTERN_PARSER
+#define RGB_KEYBOARD_PATTERN_PARSER
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    /// Syntax of a custom pattern
+    enum class pattern_syntax {
+        /// Pattern file: one "key<TAB>rrggbb" per line, lines starting with # are comments
+        file,
+        /// Commandline: "key=rrggbb;key=rrggbb;", the last ; is optional
+        keys
+    };
+
+    /// A malformed entry found by a parser (custom patterns, keymaps)
+    struct parse_diagnostic {
+        /// Line, starting at 1
+        std::size_t line;
+        /// Column (byte offset in the line), starting at 1
+        std::size_t column;
+        /// What is wrong
+        std::string message;
+    };
+
+    /// Remove spaces and tabs at both ends, and carriage returns at the end (parsers of custom patterns and keymaps)
+    inline std::string_view trim(std::string_view text) {
+        while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+            text.remove_prefix(1);
+        while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+            text.remove_suffix(1);
+        return text;
+    }
+
+    /** Parse a custom pattern in a single pass
+     *
+     * Keys are key names or key selectors (see parse_key_selector()), colors are 6 hex digits.
+     * Valid entries are stored in colors in the order they appear, also if other entries are malformed.
+     * Nothing is allocated unless an entry uses a key selector or is malformed.
+     * \param text The pattern
+     * \param syntax Syntax of text
+     * \param colors Receives the key colors
+     * \return One diagnostic for each malformed entry, empty if the pattern is valid
+     */
+    std::vector<parse_diagnostic> parse_pattern(std::string_view text, pattern_syntax syntax, key_framebuffer& colors);
+
+    /** Format diagnostics as "source:line:column: message", one per line
+     * \param source File name or other description of the pattern
+     */
+    std::string format_diagnostics(std::string_view source, const std::vector<parse_diagnostic>& diagnostics);
+
+}  // namespace rgb_keyboard
+
+#endif
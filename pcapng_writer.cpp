@@ -0,0 +1,174 @@
+#include "pcapng_writer.h"
+
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace {
+    // pcapng block types
+    constexpr uint32_t block_section_header = 0x0a0d0d0a;
+    constexpr uint32_t block_interface_description = 0x00000001;
+    constexpr uint32_t block_enhanced_packet = 0x00000006;
+
+    // link type of usbmon captures with 64 byte header
+    constexpr uint16_t linktype_usb_linux_mmapped = 220;
+
+    // usbmon transfer types
+    constexpr uint8_t transfer_control = 2;
+    constexpr uint8_t transfer_interrupt = 1;
+
+    // usbmon packet header (struct usbmon_packet in linux/Documentation/usb/usbmon.rst)
+    struct usbmon_header {
+        uint64_t id;
+        uint8_t type;
+        uint8_t transfer_type;
+        uint8_t endpoint;
+        uint8_t device;
+        uint16_t bus;
+        char flag_setup;
+        char flag_data;
+        int64_t ts_sec;
+        int32_t ts_usec;
+        int32_t status;
+        uint32_t length;
+        uint32_t length_captured;
+        uint8_t setup[8];
+        int32_t interval;
+        int32_t start_frame;
+        uint32_t transfer_flags;
+        uint32_t descriptors;
+    };
+    static_assert(sizeof(usbmon_header) == 64, "usbmon header must be 64 bytes");
+
+    template <typename T>
+    void append(std::vector<uint8_t>& buffer, T value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+    }
+}  // namespace
+
+int rgb_keyboard::pcapng_writer::open(const std::string& file, uint16_t bus, uint8_t device) {
+    out.open(file, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        return 1;
+    }
+
+    this->bus = bus;
+    this->device = device;
+    next_id = 1;
+    transfer_count = 0;
+
+    // section header: byte order magic, version 1.0, unknown section length
+    std::vector<uint8_t> section;
+    append<uint32_t>(section, 0x1a2b3c4d);
+    append<uint16_t>(section, 1);
+    append<uint16_t>(section, 0);
+    append<int64_t>(section, -1);
+    write_block(block_section_header, section.data(), section.size());
+
+    // interface description: usbmon, no snapshot length limit
+    std::vector<uint8_t> interface;
+    append<uint16_t>(interface, linktype_usb_linux_mmapped);
+    append<uint16_t>(interface, 0);
+    append<uint32_t>(interface, 0);
+    write_block(block_interface_description, interface.data(), interface.size());
+
+    return out.good() ? 0 : 1;
+}
+
+void rgb_keyboard::pcapng_writer::close() {
+    if (out.is_open())
+        out.close();
+}
+
+bool rgb_keyboard::pcapng_writer::is_open() const {
+    return out.is_open();
+}
+
+std::size_t rgb_keyboard::pcapng_writer::get_transfer_count() const {
+    return transfer_count;
+}
+
+void rgb_keyboard::pcapng_writer::record_interrupt(uint8_t endpoint, const uint8_t* data, int length) {
+    if (endpoint & 0x80) {
+        // IN: data arrives with the completion
+        write_urb('S', transfer_interrupt, endpoint, nullptr, nullptr, length, 0);
+        write_urb('C', transfer_interrupt, endpoint, nullptr, data, length, length);
+    } else {
+        // OUT: data is sent with the submission
+        write_urb('S', transfer_interrupt, endpoint, nullptr, data, length, length);
+        write_urb('C', transfer_interrupt, endpoint, nullptr, nullptr, length, 0);
+    }
+
+    next_id++;
+    transfer_count++;
+}
+
+void rgb_keyboard::pcapng_writer::record_control(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index, const uint8_t* data, int length) {
+    const uint8_t setup[8] = {request_type,
+                              request,
+                              static_cast<uint8_t>(value & 0xff),
+                              static_cast<uint8_t>(value >> 8),
+                              static_cast<uint8_t>(index & 0xff),
+                              static_cast<uint8_t>(index >> 8),
+                              static_cast<uint8_t>(length & 0xff),
+                              static_cast<uint8_t>(length >> 8)};
+
+    write_urb('S', transfer_control, 0x00, setup, data, length, length);
+    write_urb('C', transfer_control, 0x00, nullptr, nullptr, length, 0);
+
+    next_id++;
+    transfer_count++;
+}
+
+void rgb_keyboard::pcapng_writer::write_urb(char type, uint8_t transfer_type, uint8_t endpoint, const uint8_t* setup, const uint8_t* data, uint32_t urb_length,
+                                            uint32_t data_length) {
+    if (!out.is_open())
+        return;
+
+    auto now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+    // usbmon header
+    usbmon_header header{};
+    header.id = next_id;
+    header.type = type;
+    header.transfer_type = transfer_type;
+    header.endpoint = endpoint;
+    header.device = device;
+    header.bus = bus;
+    header.flag_setup = setup ? 0 : '-';
+    header.flag_data = data ? 0 : ((endpoint & 0x80) ? '<' : '>');
+    header.ts_sec = now / 1000000;
+    header.ts_usec = now % 1000000;
+    header.length = urb_length;
+    header.length_captured = data ? data_length : 0;
+    if (setup)
+        std::memcpy(header.setup, setup, sizeof(header.setup));
+
+    // enhanced packet block: interface, timestamp, lengths, packet data
+    uint32_t captured = sizeof(header) + header.length_captured;
+    std::vector<uint8_t> block;
+    append<uint32_t>(block, 0);
+    append<uint32_t>(block, static_cast<uint64_t>(now) >> 32);
+    append<uint32_t>(block, static_cast<uint64_t>(now) & 0xffffffff);
+    append<uint32_t>(block, captured);
+    append<uint32_t>(block, captured);
+    append(block, header);
+    if (data)
+        block.insert(block.end(), data, data + header.length_captured);
+
+    write_block(block_enhanced_packet, block.data(), block.size());
+}
+
+void rgb_keyboard::pcapng_writer::write_block(uint32_t type, const uint8_t* body, uint32_t length) {
+    // blocks are padded to 32 bit, the total length is stored before and after the body
+    uint32_t padding = (4 - length % 4) % 4;
+    uint32_t total = 12 + length + padding;
+    const uint8_t zeroes[4] = {0, 0, 0, 0};
+
+    out.write(reinterpret_cast<const char*>(&type), sizeof(type));
+    out.write(reinterpret_cast<const char*>(&total), sizeof(total));
+    out.write(reinterpret_cast<const char*>(body), length);
+    out.write(reinterpret_cast<const char*>(zeroes), padding);
+    out.write(reinterpret_cast<const char*>(&total), sizeof(total));
+}
@@ -0,0 +1,61 @@
+// writes usb transfers as pcapng capture
+#ifndef RGB_KEYBOARD_PCAPNG_WRITER
+#define RGB_KEYBOARD_PCAPNG_WRITER
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace rgb_keyboard {
+
+    /**
+     * This class writes USB transfers to a pcapng file, as if they were
+     * captured with usbmon on Linux (link type LINUX_USB_MMAPPED).
+     * The resulting files can be opened with Wireshark.
+     *
+     * Each transfer is recorded as a submit and a complete URB, the data is
+     * attached to the submit URB for OUT and to the complete URB for IN transfers.
+     */
+    class pcapng_writer {
+     public:
+        /** Create the file and write the section header and interface description
+         * \param bus USB bus number stored in the URBs
+         * \param device USB device address stored in the URBs
+         * \return 0 if successful, 1 if the file could not be created
+         */
+        int open(const std::string& file, uint16_t bus, uint8_t device);
+        /// Close the file
+        void close();
+        /// Returns true if the file is open
+        [[nodiscard]] bool is_open() const;
+
+        /// Record an interrupt transfer, the direction is determined by the endpoint
+        void record_interrupt(uint8_t endpoint, const uint8_t* data, int length);
+        /// Record a control transfer to endpoint 0 (host to device)
+        void record_control(uint8_t request_type, uint8_t request, uint16_t value, uint16_t index, const uint8_t* data, int length);
+
+        /// Number of recorded transfers
+        [[nodiscard]] std::size_t get_transfer_count() const;
+
+     private:
+        /// Write a single URB as enhanced packet block
+        void write_urb(char type, uint8_t transfer_type, uint8_t endpoint, const uint8_t* setup, const uint8_t* data, uint32_t urb_length, uint32_t data_length);
+        /// Write a pcapng block
+        void write_block(uint32_t type, const uint8_t* body, uint32_t length);
+
+        /// Output file
+        std::ofstream out;
+        /// USB bus number
+        uint16_t bus = 1;
+        /// USB device address
+        uint8_t device = 1;
+        /// URB id of the next transfer
+        uint64_t next_id = 1;
+        /// Number of recorded transfers
+        std::size_t transfer_count = 0;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
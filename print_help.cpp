@@ -30,7 +30,7 @@ Options:;
                             "red", "yellow", "green", "blue"
 
     -P --custom-pattern=file    Sets pattern in custom mode
-    -K --custom-keys=keys       Sets pattern in custom mode
+    -K --custom-keys=keys       Sets pattern in custom mode, keys can be key groups ("all - numpad=ff0000;")
 
     -R --report-rate=rate       Sets USB report rate (125, 250, 500, 1000) Hz
 
@@ -38,6 +38,54 @@ Options:;
 
     -r --read                   Read and print stored settings from the keyboard (experimental)
 
+    --compile=file              Don't open the keyboard, store all packets the other options
+                            would send in a packet program file
+    --apply=file                Send a packet program created with --compile to the keyboard
+    --optimize                  Remove redundant packets before sending or compiling them
+    --dry-run=file              Don't open the keyboard, write all USB transfers to a pcapng file
+    --calibration=file          Correct all colors with the calibration in file (gamma, white point)
+    --overlay=keys              Show key colors on top of the custom pattern given with -P/-K
+                            (not sent again), restore the overlaid keys afterwards
+    --blink=ms                  Blink period of --overlay
+    --ttl=ms                    Time after which --overlay is removed
+    --pattern-lib=file          Pattern library to use, lists the patterns if --pattern is not used
+    --pattern=name              Sets pattern in custom mode from the pattern library
+    --build-pattern-lib=dir     Store all .conf files in dir in the pattern library file
+    --watch                     Keep running, send changed keys whenever the -P file is saved
+                            (and the -M file, if remapping was accepted)
+    --check=dir                 Check all .conf and .keymap files in dir and its subdirectories
+    --build=dir                 With --check: compile the valid files to packet programs in dir
+    --threads=number            Number of threads for --check, default: one per cpu core
+    --animate=effect            Render an effect on the computer and show it in custom mode:
+                            gradient, wave, plasma, fire, marquee
+    --fps=number                Frame rate of --animate, --spectrum and --build-show, default: 30
+                            (--reactive: default 60, --heatmap: default 1)
+                            (--animate: 0 for the rate the keyboard can sustain)
+    --duration=seconds          Stop --animate after this time, default: until Ctrl+C
+                            (--build-show: length of the show, default: one frame after the last)
+    --palette=rrggbb,...        Colors used by --animate, --spectrum, --reactive, --heatmap and --monitor
+    --text=text                 Text shown by --animate marquee
+    --blend=mode                Blend --animate or --reactive over the -P/--custom-keys pattern:
+                            normal, add, multiply, screen, max
+    --opacity=percent           Opacity of --animate or --reactive over the pattern, default: 100
+    --stream=format             Show raw frames from stdin in custom mode: rgb24, ppm
+    --size=WIDTHxHEIGHT         Frame size of --stream rgb24
+    --spectrum=file             Show the spectrum of 16 bit PCM audio (WAV or raw, - for stdin) as bars
+    --sample-rate=hz            Sample rate of raw --spectrum input, default: 44100
+    --channels=number           Number of channels of raw --spectrum input, default: 2
+    --show=file                 Play a light show file in custom mode
+    --build-show=dir            Store the .conf and .raw frames in dir as the --show file
+    --loop=frame                With --build-show: continue with this frame after the last one
+    --reactive=device           Light up pressed keys read from an evdev device (/dev/input/eventN)
+                            or a recording of one (file or - for stdin)
+    --reactive-effect=effect    Effect of --reactive: fade, ripple, trail, default: ripple
+    --heatmap=device            Count key presses of an evdev device (or a recording) and show a heatmap
+    --heat-file=file            Counter file of --heatmap, created if it doesn't exist
+    --half-life=minutes         Time after which the heat of a key is halved, default: never
+    --monitor                   Show cpu load (F1-F12), memory (1-0), load average (q-p)
+                            and temperature (Esc) in custom mode
+    --interval=seconds          Time between --monitor samples, default: 2
+
     -B --bus=number             Specify USB bus id, must be used with --device
     -D --device=number          Specify USB device number, must be used with --bus
     -k --kernel-driver          Don't try to detach the kernel driver, required on some systems
@@ -2,7 +2,7 @@
 
 // prints all keys for custom led pattern
 int rgb_keyboard::keyboard::print_keycodes_led() {
-    for (const auto& i : keycodes) {
+    for (const auto& i : full_size_led_layout::keycodes) {
         std::cout << i.first << "\n";
     }
 
@@ -11,7 +11,7 @@ int rgb_keyboard::keyboard::print_keycodes_led() {
 
 // prints all keys for remapping
 int rgb_keyboard::keyboard::print_keycodes_remap() {
-    for (const auto& i : keymap_offsets) {
+    for (const auto& i : *ansi_keymap_layout::keymap_offsets) {
         std::cout << i.first << "\n";
     }
 
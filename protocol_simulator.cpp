@@ -0,0 +1,112 @@
+#include "protocol_simulator.h"
+
+#include <algorithm>
+
+uint64_t rgb_keyboard::protocol_simulator::memory_key(commands region, uint32_t address) {
+    return (static_cast<uint64_t>(region) << 32) | address;
+}
+
+int rgb_keyboard::protocol_simulator::process(const packet& data) {
+    switch (packet_command(data)) {
+        case commands::start:
+            if (batch_open)
+                return 1;
+            batch_open = true;
+            return 0;
+
+        case commands::end:
+            if (!batch_open)
+                return 1;
+            // apply pending writes
+            for (const auto& element : pending)
+                memory[element.first] = element.second;
+            pending.clear();
+            batch_open = false;
+            return 0;
+
+        default:
+            break;
+    }
+
+    if (!is_write_packet(data))
+        return 0;
+
+    // store payload
+    int length = std::min<int>(data[offset_length], max_payload_length);
+    uint32_t address = packet_address(data);
+    auto& target = batch_open ? pending : memory;
+    for (int i = 0; i < length; i++)
+        target[memory_key(packet_command(data), address + i)] = data[offset_payload + i];
+
+    return 0;
+}
+
+int rgb_keyboard::protocol_simulator::process(const packet* packets, std::size_t count) {
+    int errors = 0;
+    for (std::size_t i = 0; i < count; i++)
+        errors += process(packets[i]);
+
+    return errors;
+}
+
+int rgb_keyboard::protocol_simulator::process(const std::vector<packet>& packets) {
+    return process(packets.data(), packets.size());
+}
+
+bool rgb_keyboard::protocol_simulator::is_known(commands region, uint32_t address) const {
+    return memory.find(memory_key(region, address)) != memory.end();
+}
+
+uint8_t rgb_keyboard::protocol_simulator::get(commands region, uint32_t address) const {
+    auto element = memory.find(memory_key(region, address));
+    return element != memory.end() ? element->second : 0;
+}
+
+bool rgb_keyboard::protocol_simulator::is_noop(const packet& data) const {
+    if (!is_write_packet(data))
+        return false;
+
+    int length = std::min<int>(data[offset_length], max_payload_length);
+    uint32_t address = packet_address(data);
+    for (int i = 0; i < length; i++) {
+        uint64_t key = memory_key(packet_command(data), address + i);
+
+        // the value after the current batch is applied
+        auto element = batch_open ? pending.find(key) : pending.end();
+        if (element == pending.end()) {
+            element = memory.find(key);
+            if (element == memory.end())
+                return false;
+        }
+
+        if (element->second != data[offset_payload + i])
+            return false;
+    }
+
+    return true;
+}
+
+bool rgb_keyboard::protocol_simulator::in_batch() const {
+    return batch_open;
+}
+
+bool rgb_keyboard::protocol_simulator::operator==(const protocol_simulator& other) const {
+    return memory == other.memory && pending == other.pending && batch_open == other.batch_open;
+}
+
+bool rgb_keyboard::protocol_simulator::operator!=(const protocol_simulator& other) const {
+    return !(*this == other);
+}
+
+bool rgb_keyboard::protocol_simulator::equivalent(const std::vector<packet>& a, const std::vector<packet>& b, const protocol_simulator& initial) {
+    protocol_simulator simulator_a = initial;
+    protocol_simulator simulator_b = initial;
+    simulator_a.process(a);
+    simulator_b.process(b);
+
+    return simulator_a == simulator_b;
+}
+
+bool rgb_keyboard::protocol_simulator::equivalent(const std::vector<packet>& a, const std::vector<packet>& b) {
+    return equivalent(a, b, protocol_simulator());
+}
@@ -0,0 +1,75 @@
+// simulation of the keyboard protocol
+#ifndef RGB_KEYBOARD_PROTOCOL_SIMULATOR
+#define RGB_KEYBOARD_PROTOCOL_SIMULATOR
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "packet.h"
+
+namespace rgb_keyboard {
+
+    /**
+     * This class simulates the effect of data packets on the keyboard memory.
+     *
+     * The keyboard memory is modelled as one address space per write command
+     * (settings, custom led colors, keymap, ...). Writes between data_start
+     * and data_end are applied when data_end is received, writes outside of
+     * such a batch are applied immediately. Read packets don't change the memory.
+     *
+     * Only bytes that have been written are known, two simulators are equal if
+     * they know the same bytes with the same values.
+     */
+    class protocol_simulator {
+     public:
+        /** Process a single packet
+         * \return 0 if successful, 1 if the packet is a protocol error (e.g. data_end without data_start)
+         */
+        int process(const packet& data);
+        /** Process a sequence of packets
+         * \return The number of protocol errors
+         */
+        int process(const packet* packets, std::size_t count);
+        /// \see process(const packet*, std::size_t)
+        int process(const std::vector<packet>& packets);
+
+        /// Returns true if the value of a byte in the memory region of a write command is known
+        [[nodiscard]] bool is_known(commands region, uint32_t address) const;
+        /// Get a known byte, 0 if unknown
+        [[nodiscard]] uint8_t get(commands region, uint32_t address) const;
+        /** Returns true if the write packet would not change any byte once its batch is applied
+         * This includes writes of the current, not yet applied batch.
+         */
+        [[nodiscard]] bool is_noop(const packet& data) const;
+        /// Returns true if a batch has been started but not yet ended
+        [[nodiscard]] bool in_batch() const;
+
+        /// Compares the known memory and pending writes
+        bool operator==(const protocol_simulator& other) const;
+        /// \see operator==
+        bool operator!=(const protocol_simulator& other) const;
+
+        /** Check whether two packet sequences leave the keyboard in the same state
+         * \param initial The state of the keyboard before sending either sequence
+         */
+        static bool equivalent(const std::vector<packet>& a, const std::vector<packet>& b, const protocol_simulator& initial);
+        /// Check whether two packet sequences leave a keyboard with unknown memory in the same state
+        static bool equivalent(const std::vector<packet>& a, const std::vector<packet>& b);
+
+     private:
+        /// Combine region and address into a memory key
+        static uint64_t memory_key(commands region, uint32_t address);
+
+        /// Applied memory ( region and address → value )
+        std::map<uint64_t, uint8_t> memory;
+        /// Writes of the current batch ( region and address → value )
+        std::map<uint64_t, uint8_t> pending;
+        /// Has a batch been started?
+        bool batch_open = false;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,174 @@
+#include "reactive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "key_events.h"
+#include "rgb_keyboard.h"
+#include "static_table.h"
+
+namespace {
+    using rgb_keyboard::reactive_effects;
+    using clock = reactive_effects::clock;
+
+    constexpr rgb_keyboard::static_table<reactive_effects::effects, 3> effect_table = {{
+        {"fade", reactive_effects::effects::fade},
+        {"ripple", reactive_effects::effects::ripple},
+        {"trail", reactive_effects::effects::trail},
+    }};
+
+    // speed of the ripple ring in key units per second, and its width
+    constexpr float ripple_speed = 15.0f;
+    constexpr float ripple_width = 1.5f;
+    // brightness of the neighbours of a trail
+    constexpr float trail_neighbour = 0.5f;
+}  // namespace
+
+rgb_keyboard::reactive_effects::effects rgb_keyboard::reactive_effects::parse_effect(std::string_view name) {
+    const effects* found = effect_table.find(name);
+    if (found == nullptr)
+        throw std::invalid_argument("Unknown reactive effect: " + std::string(name));
+    return *found;
+}
+
+rgb_keyboard::reactive_effects::reactive_effects(effects effect, const key_geometry& geometry, const std::vector<color>& palette)
+    : effect(effect), geometry(geometry) {
+    std::vector<color> colors;
+    switch (effect) {
+        case effects::fade:
+            colors = {{0x00, 0x00, 0x00}, {0xff, 0xff, 0xff}};
+            lifetime = std::chrono::milliseconds(500);
+            break;
+        case effects::ripple:
+            colors = {{0x00, 0x00, 0x00}, {0x00, 0x40, 0xff}, {0x00, 0xff, 0xff}};
+            lifetime = std::chrono::milliseconds(800);
+            break;
+        case effects::trail:
+            colors = {{0x00, 0x00, 0x00}, {0xff, 0x00, 0x00}, {0xff, 0xff, 0x00}};
+            lifetime = std::chrono::milliseconds(1500);
+            break;
+    }
+    this->palette = animation::make_palette(palette.empty() ? colors : palette);
+    presses.reserve(max_presses);
+}
+
+void rgb_keyboard::reactive_effects::press(int key, clock::time_point time) {
+    if (!geometry.keys.test(key))
+        return;
+    if (presses.size() == max_presses)
+        presses.erase(presses.begin());
+    presses.push_back({key, time});
+}
+
+bool rgb_keyboard::reactive_effects::render(clock::time_point time, key_framebuffer& colors, uint8_t* alpha) {
+    presses.erase(std::remove_if(presses.begin(), presses.end(), [&](const key_press& p) { return time - p.time >= lifetime; }), presses.end());
+
+    // the brightest effect wins
+    values.fill(0);
+    for (const auto& p : presses) {
+        const float age = std::max(std::chrono::duration<float>(time - p.time).count(), 0.0f);
+        const float remaining = 1 - age / std::chrono::duration<float>(lifetime).count();
+        const float fade = remaining * remaining;
+
+        switch (effect) {
+            case effects::fade:
+                values[p.key] = std::max(values[p.key], fade);
+                break;
+            case effects::ripple: {
+                // ring around the pressed key, from the precomputed key distances
+                const float radius = age * ripple_speed;
+                const float* distance = geometry.distance[p.key].data();
+                for (int key = 0; key < max_keys; key++) {
+                    const float ring = std::max(1 - std::fabs(distance[key] - radius) / ripple_width, 0.0f);
+                    values[key] = std::max(values[key], ring * remaining);
+                }
+                values[p.key] = std::max(values[p.key], fade);
+                break;
+            }
+            case effects::trail:
+                values[p.key] = std::max(values[p.key], fade);
+                for (int i = 0; i < geometry.neighbour_count[p.key]; i++) {
+                    const int neighbour = geometry.neighbours[p.key][i];
+                    values[neighbour] = std::max(values[neighbour], fade * trail_neighbour);
+                }
+                break;
+        }
+    }
+
+    // map values to palette entries
+    for (int i = 0; i < max_keys; i++) {
+        int index = static_cast<int>(std::min(values[i], 1.0f) * 255.0f + 0.5f);
+        channels[0][i] = palette[0][index];
+        channels[1][i] = palette[1][index];
+        channels[2][i] = palette[2][index];
+        alpha[i] = index;
+    }
+    colors.set(geometry.keys, channels[0].data(), channels[1].data(), channels[2].data());
+
+    return !presses.empty();
+}
+
+rgb_keyboard::reactive_effects::statistics rgb_keyboard::reactive_effects::play(keyboard& kbd, int fd, int fps, const volatile std::sig_atomic_t& stop,
+                                                                                int layer) {
+    statistics stats;
+    key_framebuffer frame;
+    std::array<uint8_t, max_keys> alpha;
+    const clock::duration period = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / std::max(fps, 1)));
+
+    auto show = [&](clock::time_point time) {
+        const bool running = render(time, frame, alpha.data());
+        if (layer != 0)
+            kbd.set_layer(layer, frame, alpha.data());
+        else
+            kbd.set_custom_pattern(frame);
+        return running;
+    };
+
+    // first frame, then switch to the custom mode
+    show(clock::now());
+    kbd.write_custom_mode();
+
+    key_event_reader reader(fd);
+    bool running = false;
+    clock::time_point deadline;
+    // presses shown by the next frame
+    std::vector<key_event_reader::key_press> pending;
+
+    while (!stop) {
+        // sleep until the next frame or input, wake up regularly to check for signals
+        reader.wait(running ? deadline : clock::now() + std::chrono::milliseconds(100));
+
+        // read all available events, a burst of presses is shown by one frame
+        reader.read(pending);
+        const auto now = clock::now();
+        for (const auto& p : pending)
+            press(p.key, p.time);
+        stats.presses += pending.size();
+
+        // key presses are sent right away, running effects at the frame rate
+        if (!pending.empty() || (running && now >= deadline)) {
+            // absolute deadlines as in frame_pacer::wait(), sending doesn't shift later frames and missed deadlines are skipped,
+            // a press while no effect is running starts the schedule
+            if (!running)
+                deadline = now + period;
+            else if (now >= deadline)
+                deadline += ((now - deadline) / period + 1) * period;
+            running = show(now);
+            const auto transfer_start = clock::now();
+            kbd.write_custom();
+            const auto sent = clock::now();
+            stats.transfer.add(sent - transfer_start);
+            for (const auto& p : pending)
+                stats.latency.add(sent - p.time);
+            pending.clear();
+            stats.frames++;
+        }
+
+        if (reader.ended() && !running)
+            break;
+    }
+
+    return stats;
+}
@@ -0,0 +1,124 @@
+// host side reactive effects driven by key events
+#ifndef RGB_KEYBOARD_REACTIVE
+#define RGB_KEYBOARD_REACTIVE
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+#include "animation.h"
+#include "frame_pacer.h"
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * This class lights up keys when they are pressed, like the reactive led modes but rendered on the computer.
+     *
+     * Key events are read from an evdev device (/dev/input/eventN) or from a recording of one (see
+     * key_event_reader). Each key press starts an effect at the pressed key, the effects of all
+     * recent presses are combined. A key press is rendered and sent right away instead of waiting for the next frame,
+     * frames at the given rate are only sent while effects are fading. The time from each key
+     * event to the end of the USB transfer that shows it is recorded.
+     */
+    class reactive_effects {
+     public:
+        using clock = std::chrono::steady_clock;
+
+        /// The effect started by a key press
+        enum class effects {
+            /// The pressed key lights up and fades out
+            fade,
+            /// A ring expands from the pressed key
+            ripple,
+            /// The pressed key and its neighbours light up and fade out slowly
+            trail
+        };
+
+        /// Timing of the key presses
+        struct statistics {
+            /// Key presses read
+            std::size_t presses = 0;
+            /// Frames sent
+            std::size_t frames = 0;
+            /// Time from a key event to the end of the transfer of the frame showing it
+            frame_pacer::histogram latency;
+            /// Time of write_custom()
+            frame_pacer::histogram transfer;
+        };
+
+        /** Parse the name of an effect
+         * \throws std::invalid_argument if the name is unknown
+         */
+        static effects parse_effect(std::string_view name);
+
+        /** Create reactive effects
+         * \param effect Effect started by a key press
+         * \param geometry Key positions of the keyboard
+         * \param palette Colors the effect intensity is mapped to (evenly spaced, off to full), empty for the default palette of the effect
+         */
+        reactive_effects(effects effect, const key_geometry& geometry, const std::vector<color>& palette = {});
+
+        /** Start an effect
+         * Only the most recent presses are kept, see max_presses.
+         * \param key Key index of the pressed key
+         * \param time Time of the key press
+         */
+        void press(int key, clock::time_point time);
+
+        /** Render a frame
+         * Effects that have ended are removed.
+         * \param time Time of the frame
+         * \param colors Receives the colors of all keys of the geometry
+         * \param alpha Receives the intensity of each key (0 - 255), indexed by the key index
+         * \return true if an effect is still running
+         */
+        bool render(clock::time_point time, key_framebuffer& colors, uint8_t* alpha);
+
+        /** Switch the keyboard to the custom led mode and show the effects of the key events read from a file descriptor
+         * The descriptor is an evdev device, a pipe or a regular file containing input_event records, see key_event_reader.
+         * \param kbd The opened keyboard, frames are sent to its current profile
+         * \param fd File descriptor to read input_event records from
+         * \param fps Frames per second while effects are running
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \param layer Layer of the keyboard the effects are drawn into (see keyboard::add_layer()), 0 to replace the custom pattern
+         * \return Counters and timing, after the end of the input or when stop is set
+         */
+        statistics play(keyboard& kbd, int fd, int fps, const volatile std::sig_atomic_t& stop, int layer = 0);
+
+     private:
+        /// Number of presses whose effects are shown at the same time
+        static constexpr std::size_t max_presses = 64;
+
+        /// A key press with a running effect
+        struct key_press {
+            int key;
+            clock::time_point time;
+        };
+
+        /// Effect started by a key press
+        effects effect;
+        /// Key positions
+        const key_geometry& geometry;
+        /// Palette lookup tables
+        animation::palette_table palette;
+        /// Length of the effect
+        clock::duration lifetime;
+        /// Presses with a running effect, oldest first
+        std::vector<key_press> presses;
+
+        /// Intensity of each key in the current frame
+        alignas(64) std::array<float, max_keys> values{};
+        /// Colors of the current frame
+        alignas(64) std::array<std::array<uint8_t, max_keys>, 3> channels{};
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
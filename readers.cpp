@@ -5,18 +5,14 @@
 int rgb_keyboard::keyboard::read_active_profile() {
     // prepare data packet
     uint8_t data_read[64];
-    std::copy(std::begin(data_read), std::end(data_read), std::begin(data_read));
+    std::copy(std::begin(keyboard::data_read), std::end(keyboard::data_read), std::begin(data_read));
     data_read[1] = 0x2f;
     data_read[3] = 0x03;
     data_read[4] = 0x2c;
 
-    int transferred = 0;
-    // write data packet to endpoint 3
-    int res = libusb_interrupt_transfer(handle, 0x03, data_read, 64, &transferred, 1000);
-
-    // read from endpoint 2
+    // send request, receive data
     uint8_t buffer[64];
-    res += libusb_interrupt_transfer(handle, 0x82, buffer, 64, &transferred, 1000);
+    read_data(data_read, buffer);
 
     // check if valid profile number
     if (buffer[18] + 1 >= 1 && buffer[18] + 1 <= 3) {
@@ -49,25 +45,11 @@ int rgb_keyboard::keyboard::read_led_settings() {
     data_read_3[4] = 0x38;
     data_read_3[5] = 0x54;
 
-    int transferred = 0;
-    // write data packet 1 to endpoint 3
-    int res = libusb_interrupt_transfer(handle, 0x03, data_read_1, 64, &transferred, 1000);
-
+    // send requests, receive data
     uint8_t input_buffer[3][64];
-    // read from endpoint 2
-    res += libusb_interrupt_transfer(handle, 0x82, input_buffer[0], 64, &transferred, 1000);
-
-    // write data packet 2 to endpoint 3
-    res += libusb_interrupt_transfer(handle, 0x03, data_read_2, 64, &transferred, 1000);
-
-    // read from endpoint 2
-    res += libusb_interrupt_transfer(handle, 0x82, input_buffer[1], 64, &transferred, 1000);
-
-    // write data packet 3 to endpoint 3
-    res += libusb_interrupt_transfer(handle, 0x03, data_read_3, 64, &transferred, 1000);
-
-    // read from endpoint 2
-    res += libusb_interrupt_transfer(handle, 0x82, input_buffer[2], 64, &transferred, 1000);
+    read_data(data_read_1, input_buffer[0]);
+    read_data(data_read_2, input_buffer[1]);
+    read_data(data_read_3, input_buffer[2]);
 
     // extract information
     for (int i = 0; i < 3; i++) {
@@ -82,11 +64,11 @@ int rgb_keyboard::keyboard::read_led_settings() {
         }
 
         // brightness
-        if (input_buffer[i][9] >= brightness_min && input_buffer[i][9] <= brightness_max)
+        if (input_buffer[i][9] >= brightness_min && input_buffer[i][9] <= model->brightness_max)
             brightness[i] = input_buffer[i][9];
 
         // speed
-        if (3 - input_buffer[i][10] >= speed_min && 3 - input_buffer[i][10] <= speed_max)
+        if (3 - input_buffer[i][10] >= speed_min && 3 - input_buffer[i][10] <= model->speed_max)
             speed[i] = 3 - input_buffer[i][10];
 
         // direction
@@ -1,16 +1,116 @@
 #include "rgb_keyboard.h"
 
+#include <chrono>
+#include <csignal>
+#include <cstdint>
 #include <exception>
+#include <filesystem>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <regex>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #include <cxxopts.hpp>
+#include <fcntl.h>
 #include <getopt.h>
+#include <unistd.h>
 
+#include "animation.h"
+#include "compositor.h"
+#include "config_checker.h"
+#include "file_watcher.h"
+#include "frame_pacer.h"
+#include "frame_stream.h"
+#include "heatmap.h"
+#include "light_show.h"
+#include "packet_optimizer.h"
+#include "pattern_library.h"
 #include "print_help.h"
+#include "reactive.h"
+#include "spectrum.h"
+#include "system_monitor.h"
+
+namespace {
+    // set by SIGINT and SIGTERM, ends the --overlay, --watch, --animate, --stream, --spectrum, --show, --reactive, --heatmap and --monitor loops
+    volatile std::sig_atomic_t interrupted = 0;
+    void interrupt_handler(int) { interrupted = 1; }
+
+    // one line of a timing histogram: minimum, percentiles and maximum in milliseconds
+    void print_timing(const char* name, const rgb_keyboard::frame_pacer::histogram& histogram) {
+        auto ms = [](rgb_keyboard::frame_pacer::clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); };
+        std::cout << std::fixed << std::setprecision(3) << name << ": " << ms(histogram.min()) << " ms minimum, " << ms(histogram.percentile(0.5))
+                  << " ms median, " << ms(histogram.percentile(0.9)) << " ms 90%, " << ms(histogram.percentile(0.99)) << " ms 99%, "
+                  << ms(histogram.max()) << " ms maximum\n";
+    }
+
+    // select the --profile the colors are sent to, false if it is invalid
+    bool select_profile(rgb_keyboard::keyboard& kbd, const cxxopts::ParseResult& options) {
+        if (options.count("profile") == 0)
+            return true;
+        const auto& profile = options["profile"].as<int>();
+        if (profile > 3 or profile < 1) {
+            std::cerr << "Invalid profile, expected 1-3\n";
+            return false;
+        }
+        kbd.set_profile(profile);
+        return true;
+    }
+
+    // --palette: comma separated colors, empty if not given, false if a color is invalid
+    bool parse_palette(const cxxopts::ParseResult& options, std::vector<rgb_keyboard::color>& palette) {
+        palette.clear();
+        if (options.count("palette") == 0)
+            return true;
+        const std::regex color_format("[0-9a-fA-F]{6}");
+        std::stringstream colors(options["palette"].as<std::string>());
+        for (std::string color; std::getline(colors, color, ',');) {
+            if (!std::regex_match(color, color_format)) {
+                std::cerr << "Wrong palette format, expected rrggbb,rrggbb,...\n";
+                return false;
+            }
+            palette.push_back({uint8_t(stoi(color.substr(0, 2), nullptr, 16)), uint8_t(stoi(color.substr(2, 2), nullptr, 16)),
+                               uint8_t(stoi(color.substr(4, 2), nullptr, 16))});
+        }
+        return true;
+    }
+
+    // the layer an effect is drawn into: with a custom pattern a layer on top of it, 0 otherwise, overlays are shown on top of both
+    bool setup_effect_layer(rgb_keyboard::keyboard& kbd, const cxxopts::ParseResult& options, int& layer) {
+        layer = 0;
+        if (options.count("custom-pattern") != 0 or options.count("custom-keys") != 0 or options.count("blend") != 0 or options.count("opacity") != 0) {
+            rgb_keyboard::compositor::blend_modes mode = rgb_keyboard::compositor::blend_modes::normal;
+            try {
+                if (options.count("blend") != 0)
+                    mode = rgb_keyboard::compositor::parse_blend_mode(options["blend"].as<std::string>());
+            } catch (std::invalid_argument&) {
+                std::cerr << "Unknown blend mode '" << options["blend"].as<std::string>() << "'. Valid options are:\nnormal add multiply screen max\n";
+                return false;
+            }
+            const int opacity = options.count("opacity") != 0 ? options["opacity"].as<int>() : 100;
+            if (opacity < 0 or opacity > 100) {
+                std::cerr << "Invalid opacity, expected 0-100\n";
+                return false;
+            }
+            if (options.count("custom-pattern") != 0 && kbd.load_custom(options["custom-pattern"].as<std::string>()) != 0) {
+                std::cerr << "Couldn't open custom pattern file.\n";
+                return false;
+            }
+            if (options.count("custom-keys") != 0)
+                kbd.set_custom_keys(options["custom-keys"].as<std::string>());
+            layer = kbd.add_layer(mode, static_cast<uint8_t>(opacity * 255 / 100));
+        }
+        if (options.count("overlay") != 0) {
+            const std::chrono::milliseconds period(options.count("blink") != 0 ? options["blink"].as<int>() : 0);
+            const std::chrono::milliseconds ttl(options.count("ttl") != 0 ? options["ttl"].as<int>() : 0);
+            for (const auto& keys : options["overlay"].as<std::vector<std::string>>())
+                kbd.add_overlay(rgb_keyboard::keyboard::parse_custom_keys(keys), period, ttl);
+        }
+        return true;
+    }
+}  // namespace
 
 int main(int argc, char** argv) {
     cxxopts::Options parser{"rgb_keyboard", "This software controls the RGB lighting on some keyboards."};
@@ -26,8 +126,8 @@ int main(int argc, char** argv) {
         ("P,custom-pattern", "", cxxopts::value<std::string>())
         ("K,custom-keys", "", cxxopts::value<std::string>())
         ("R,report-rate", "", cxxopts::value<int>())
-        ("M,keymap", "", cxxopts::value<int>())
-        ("L,list-keys", "", cxxopts::value<int>())
+        ("M,keymap", "", cxxopts::value<std::string>())
+        ("L,list-keys", "", cxxopts::value<std::string>())
         ("B,bus", "", cxxopts::value<int>())
         ("D,device", "", cxxopts::value<int>())
         ("p,profile", "", cxxopts::value<int>())
@@ -35,7 +135,44 @@ int main(int argc, char** argv) {
         ("k,kernel-driver", "")
         ("A,ajazzak33", "")
         ("I,interface0", "")
-        ("r,read", "");
+        ("r,read", "")
+        ("compile", "", cxxopts::value<std::string>())
+        ("apply", "", cxxopts::value<std::string>())
+        ("optimize", "")
+        ("dry-run", "", cxxopts::value<std::string>())
+        ("calibration", "", cxxopts::value<std::string>())
+        ("overlay", "", cxxopts::value<std::vector<std::string>>())
+        ("blink", "", cxxopts::value<int>())
+        ("ttl", "", cxxopts::value<int>())
+        ("pattern-lib", "", cxxopts::value<std::string>())
+        ("pattern", "", cxxopts::value<std::string>())
+        ("build-pattern-lib", "", cxxopts::value<std::string>())
+        ("watch", "")
+        ("check", "", cxxopts::value<std::string>())
+        ("build", "", cxxopts::value<std::string>())
+        ("threads", "", cxxopts::value<int>())
+        ("animate", "", cxxopts::value<std::string>())
+        ("fps", "", cxxopts::value<int>())
+        ("duration", "", cxxopts::value<double>())
+        ("palette", "", cxxopts::value<std::string>())
+        ("text", "", cxxopts::value<std::string>())
+        ("stream", "", cxxopts::value<std::string>())
+        ("size", "", cxxopts::value<std::string>())
+        ("spectrum", "", cxxopts::value<std::string>())
+        ("sample-rate", "", cxxopts::value<int>())
+        ("channels", "", cxxopts::value<int>())
+        ("blend", "", cxxopts::value<std::string>())
+        ("opacity", "", cxxopts::value<int>())
+        ("show", "", cxxopts::value<std::string>())
+        ("build-show", "", cxxopts::value<std::string>())
+        ("loop", "", cxxopts::value<int>())
+        ("reactive", "", cxxopts::value<std::string>())
+        ("reactive-effect", "", cxxopts::value<std::string>())
+        ("heatmap", "", cxxopts::value<std::string>())
+        ("heat-file", "", cxxopts::value<std::string>())
+        ("half-life", "", cxxopts::value<double>())
+        ("monitor", "")
+        ("interval", "", cxxopts::value<double>());
     // clang-format on
 
     // these variables store the commandline options
@@ -113,6 +250,144 @@ int main(int argc, char** argv) {
         return 0;
     }
 
+    // pattern library: build or list, no keyboard needed
+    if (options.count("pattern-lib") == 0 and (options.count("pattern") != 0 or options.count("build-pattern-lib") != 0)) {
+        std::cerr << "--pattern and --build-pattern-lib require --pattern-lib\n";
+        return 1;
+    }
+    if (options.count("build-pattern-lib") != 0) {
+        // each .conf file in the directory is a pattern, named after the file
+        std::vector<std::pair<std::string, rgb_keyboard::key_framebuffer>> patterns;
+        try {
+            for (const auto& file : std::filesystem::directory_iterator(options["build-pattern-lib"].as<std::string>())) {
+                if (file.path().extension() != ".conf")
+                    continue;
+
+                rgb_keyboard::keyboard pattern_kbd;
+                if (pattern_kbd.load_custom(file.path().string()) != 0) {
+                    std::cerr << "Couldn't open custom pattern file " << file.path() << ".\n";
+                    return 1;
+                }
+                patterns.emplace_back(file.path().stem().string(), pattern_kbd.get_custom_colors());
+            }
+
+            // same file for the same directory contents
+            std::sort(patterns.begin(), patterns.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+
+            if (rgb_keyboard::pattern_library::save(options["pattern-lib"].as<std::string>(), patterns) != 0) {
+                std::cerr << "Couldn't write pattern library file.\n";
+                return 1;
+            }
+        } catch (std::exception& e) {
+            std::cerr << "Couldn't build pattern library: " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Stored " << patterns.size() << " patterns in " << options["pattern-lib"].as<std::string>() << "\n";
+        return 0;
+    }
+    // encode a directory of frames as a light show, no keyboard needed
+    if (options.count("build-show") != 0 and options.count("show") == 0) {
+        std::cerr << "--build-show requires --show\n";
+        return 1;
+    }
+    if (options.count("build-show") != 0) {
+        const int fps = options.count("fps") != 0 ? options["fps"].as<int>() : 30;
+        if (fps < 1 or fps > 1000) {
+            std::cerr << "Invalid frame rate, expected 1-1000\n";
+            return 1;
+        }
+        // the show file stores milliseconds and frame indices as 32 bit unsigned numbers
+        if (options.count("duration") != 0 and !(options["duration"].as<double>() >= 0 and options["duration"].as<double>() * 1000 < UINT32_MAX)) {
+            std::cerr << "Invalid duration, expected 0-4294967 seconds\n";
+            return 1;
+        }
+        if (options.count("loop") != 0 and options["loop"].as<int>() < 0) {
+            std::cerr << "Invalid loop frame, expected 0 or more\n";
+            return 1;
+        }
+        std::size_t frame_count = 0;
+        try {
+            const auto frames = rgb_keyboard::light_show::read_frames(options["build-show"].as<std::string>(), fps,
+                                                                      rgb_keyboard::keyboard().get_key_geometry().keys);
+            frame_count = frames.size();
+
+            // the last frame is shown for one frame, unless the length is given
+            uint32_t duration = frame_count * 1000 / fps;
+            if (options.count("duration") != 0)
+                duration = static_cast<uint32_t>(options["duration"].as<double>() * 1000);
+            const uint32_t loop_frame = options.count("loop") != 0 ? options["loop"].as<int>() : rgb_keyboard::light_show::no_loop;
+
+            if (rgb_keyboard::light_show::save(options["show"].as<std::string>(), frames, loop_frame, duration) != 0) {
+                std::cerr << "Couldn't write light show file.\n";
+                return 1;
+            }
+        } catch (std::exception& e) {
+            std::cerr << "Couldn't build light show: " << e.what() << "\n";
+            return 1;
+        }
+        std::cout << "Stored " << frame_count << " frames in " << options["show"].as<std::string>() << "\n";
+        return 0;
+    }
+
+    rgb_keyboard::pattern_library library;
+    if (options.count("pattern-lib") != 0) {
+        if (library.load(options["pattern-lib"].as<std::string>()) != 0) {
+            std::cerr << "Couldn't open pattern library file.\n";
+            return 1;
+        }
+
+        // only a library: list the patterns
+        if (options.count("pattern") == 0) {
+            for (std::size_t i = 0; i < library.size(); i++)
+                std::cout << library.name(i) << "\n";
+            return 0;
+        }
+    }
+
+    // check (and compile) a directory of configuration files, no keyboard needed
+    if (options.count("build") != 0 and options.count("check") == 0) {
+        std::cerr << "--build requires --check\n";
+        return 1;
+    }
+    if (options.count("check") != 0) {
+        int profile = options.count("profile") != 0 ? options["profile"].as<int>() : 1;
+        if (profile > 3 or profile < 1) {
+            std::cerr << "Invalid profile, expected 1-3\n";
+            return 1;
+        }
+        int threads = options.count("threads") != 0 ? options["threads"].as<int>() : 0;
+        if (threads < 0) {
+            std::cerr << "Invalid number of threads\n";
+            return 1;
+        }
+
+        std::vector<rgb_keyboard::check_result> results;
+        try {
+            rgb_keyboard::thread_pool pool(threads);
+            results = rgb_keyboard::check_configs(options["check"].as<std::string>(), kbd.get_device_model(), profile,
+                                                  options.count("build") != 0 ? options["build"].as<std::string>() : "", pool);
+        } catch (std::exception& e) {
+            std::cerr << "Couldn't check configuration files: " << e.what() << "\n";
+            return 1;
+        }
+
+        // report in path order
+        std::size_t failed = 0, compiled = 0;
+        for (const auto& result : results) {
+            if (!result.diagnostics.empty())
+                std::cerr << rgb_keyboard::format_diagnostics(result.file, result.diagnostics) << "\n";
+            if (!result.error.empty())
+                std::cerr << result.file << ": " << result.error << "\n";
+            failed += result.ok() ? 0 : 1;
+            compiled += result.program.empty() ? 0 : 1;
+        }
+        std::cout << "Checked " << results.size() << " files, " << failed << " with errors";
+        if (options.count("build") != 0)
+            std::cout << ", compiled " << compiled << " packet programs";
+        std::cout << "\n";
+        return failed == 0 ? 0 : 1;
+    }
+
     // detach kernel driver ?
     if (options.count("kernel-driver") != 0)
         kbd.set_detach_kernel_driver(false);
@@ -121,6 +396,70 @@ int main(int argc, char** argv) {
     if (options.count("interface0") != 0)
         kbd.set_open_interface_0(false);
 
+    // compile settings to a packet program instead of sending them?
+    const bool compile = options.count("compile") != 0;
+    // optimize packets before sending/storing them?
+    const bool optimize = options.count("optimize") != 0;
+    if (compile and (options.count("read") != 0 or options.count("apply") != 0 or options.count("dry-run") != 0)) {
+        std::cerr << "--compile can't be used together with --read, --apply or --dry-run\n";
+        return 1;
+    }
+    if (options.count("overlay") != 0 and (compile or optimize)) {
+        std::cerr << "--overlay can't be used together with --compile or --optimize\n";
+        return 1;
+    }
+    // reload the pattern/keymap file when it changes?
+    const bool watch = options.count("watch") != 0;
+    if (watch and options.count("custom-pattern") == 0) {
+        std::cerr << "--watch needs --custom-pattern\n";
+        return 1;
+    }
+    if (watch and (compile or optimize or options.count("overlay") != 0)) {
+        std::cerr << "--watch can't be used together with --compile, --optimize or --overlay\n";
+        return 1;
+    }
+
+    if (options.count("animate") != 0 and (compile or optimize or watch)) {
+        std::cerr << "--animate can't be used together with --compile, --optimize or --watch\n";
+        return 1;
+    }
+    if (options.count("stream") != 0 and (compile or optimize or watch or options.count("overlay") != 0 or options.count("animate") != 0)) {
+        std::cerr << "--stream can't be used together with --compile, --optimize, --watch, --overlay or --animate\n";
+        return 1;
+    }
+    if (options.count("spectrum") != 0 and
+        (compile or optimize or watch or options.count("overlay") != 0 or options.count("animate") != 0 or options.count("stream") != 0)) {
+        std::cerr << "--spectrum can't be used together with --compile, --optimize, --watch, --overlay, --animate or --stream\n";
+        return 1;
+    }
+    if (options.count("show") != 0 and (compile or optimize or watch or options.count("overlay") != 0 or options.count("animate") != 0 or
+                                        options.count("stream") != 0 or options.count("spectrum") != 0)) {
+        std::cerr << "--show can't be used together with --compile, --optimize, --watch, --overlay, --animate, --stream or --spectrum\n";
+        return 1;
+    }
+    if (options.count("reactive") != 0 and (compile or optimize or watch or options.count("animate") != 0 or options.count("stream") != 0 or
+                                            options.count("spectrum") != 0 or options.count("show") != 0)) {
+        std::cerr << "--reactive can't be used together with --compile, --optimize, --watch, --animate, --stream, --spectrum or --show\n";
+        return 1;
+    }
+    if (options.count("heatmap") != 0 and (compile or optimize or watch or options.count("overlay") != 0 or options.count("animate") != 0 or
+                                           options.count("stream") != 0 or options.count("spectrum") != 0 or options.count("show") != 0 or
+                                           options.count("reactive") != 0)) {
+        std::cerr << "--heatmap can't be used together with --compile, --optimize, --watch, --overlay, --animate, --stream, --spectrum, --show or --reactive\n";
+        return 1;
+    }
+    if (options.count("monitor") != 0 and (compile or optimize or watch or options.count("overlay") != 0 or options.count("animate") != 0 or
+                                           options.count("stream") != 0 or options.count("spectrum") != 0 or options.count("show") != 0 or
+                                           options.count("reactive") != 0 or options.count("heatmap") != 0)) {
+        std::cerr << "--monitor can't be used together with --compile, --optimize, --watch, --overlay, --animate, --stream, --spectrum, --show, --reactive or "
+                     "--heatmap\n";
+        return 1;
+    }
+    if (options.count("heatmap") != 0 and options.count("heat-file") == 0) {
+        std::cerr << "--heatmap requires --heat-file\n";
+        return 1;
+    }
+
     // open keyboard, apply settigns, close keyboard
     try {
         // open keyboard
@@ -128,7 +467,19 @@ int main(int argc, char** argv) {
             std::cerr << "--bus and --device must be used together\n";
             return 1;
         }
-        if ((options.count("bus") != 0) and (options.count("device") != 0)) {  // -B and -D
+        if (compile) {  // no keyboard needed, store all packets
+            kbd.begin_capture();
+
+        } else if (options.count("dry-run") != 0) {  // no keyboard needed, record transfers to file
+            const auto& dry_run = options["dry-run"].as<std::string>();
+            int bus = options.count("bus") != 0 ? options["bus"].as<int>() : 1;
+            int device = options.count("device") != 0 ? options["device"].as<int>() : 1;
+            if (kbd.open_dry_run(dry_run, bus, device) != 0) {
+                std::cerr << "Couldn't create dry run capture file.\n";
+                return 1;
+            }
+
+        } else if ((options.count("bus") != 0) and (options.count("device") != 0)) {  // -B and -D
             const auto& bus = options["bus"].as<int>();
             const auto& device = options["device"].as<int>();
 
@@ -145,9 +496,359 @@ int main(int argc, char** argv) {
             }
         }
 
+        // load color calibration, this depends on the model and serial number of the opened keyboard
+        if (options.count("calibration") != 0) {
+            const auto& calibration = options["calibration"].as<std::string>();
+            if (kbd.load_calibration(calibration) != 0) {
+                std::cerr << "Couldn't open calibration file.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+        }
+
+        // show overlays on top of the custom pattern, restore the pattern when they expire
+        if (options.count("overlay") != 0 and options.count("animate") == 0 and options.count("reactive") == 0) {
+            // --custom-pattern and --custom-keys describe what the keyboard displays, they are not sent again
+            if (options.count("custom-pattern") != 0 && kbd.load_custom(options["custom-pattern"].as<std::string>()) != 0) {
+                std::cerr << "Couldn't open custom pattern file.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            if (options.count("custom-keys") != 0)
+                kbd.set_custom_keys(options["custom-keys"].as<std::string>());
+            kbd.assume_custom_written();
+
+            const std::chrono::milliseconds period(options.count("blink") != 0 ? options["blink"].as<int>() : 0);
+            const std::chrono::milliseconds ttl(options.count("ttl") != 0 ? options["ttl"].as<int>() : 0);
+            for (const auto& keys : options["overlay"].as<std::vector<std::string>>())
+                kbd.add_overlay(rgb_keyboard::keyboard::parse_custom_keys(keys), period, ttl);
+
+            // update the keyboard whenever an overlay blinks or expires
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            kbd.write_custom();
+            while (kbd.get_overlays_active() && kbd.get_next_overlay_change() != std::chrono::steady_clock::time_point::max()) {
+                if (interrupted) {
+                    kbd.clear_overlays();
+                } else {
+                    // wake up regularly to check for signals
+                    auto wakeup = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+                    std::this_thread::sleep_until(std::min(kbd.get_next_overlay_change(), wakeup));
+                }
+                kbd.write_custom();
+            }
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // render an animation on the host and stream it in the custom led mode
+        if (options.count("animate") != 0) {
+            const int fps = options.count("fps") != 0 ? options["fps"].as<int>() : 30;
+            if (fps < 0 or fps > 1000) {
+                std::cerr << "Invalid frame rate, expected 0-1000\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            std::vector<rgb_keyboard::color> palette;
+            if (!select_profile(kbd, options) or !parse_palette(options, palette)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            const auto& effect = options["animate"].as<std::string>();
+            const auto effects = rgb_keyboard::animation::effects();
+            if (std::find(effects.begin(), effects.end(), effect) == effects.end()) {
+                std::cerr << "Unknown effect '" << effect << "'. Valid options are:\n";
+                for (const auto& name : effects)
+                    std::cerr << name << " ";
+                std::cerr << "\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            rgb_keyboard::animation animation(effect, kbd.get_key_geometry(), palette, options.count("text") != 0 ? options["text"].as<std::string>() : "");
+
+            int layer = 0;
+            if (!setup_effect_layer(kbd, options, layer)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            const auto duration = std::chrono::duration_cast<rgb_keyboard::animation::clock::duration>(
+                std::chrono::duration<double>(options.count("duration") != 0 ? options["duration"].as<double>() : 0));
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = animation.play(kbd, fps, duration, interrupted, layer);
+
+            std::cout << std::fixed << std::setprecision(1) << "Sent " << stats.frames << " frames: " << stats.fps() << " fps, " << stats.skipped
+                      << " frames skipped, sustainable " << stats.sustainable_fps() << " fps\n";
+            print_timing("Frame interval", stats.interval);
+            print_timing("Wake up lateness", stats.lateness);
+            print_timing("Render time", stats.render);
+            print_timing("USB time", stats.transfer);
+            std::cout << std::setprecision(1) << "Keyboard: " << std::chrono::duration<double, std::milli>(kbd.get_packet_time()).count()
+                      << " ms per packet, " << kbd.get_sustainable_fps(kbd.get_key_geometry().keys.count()) << " fps with all keys changing\n";
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // light up pressed keys, read from an evdev device or a recording
+        if (options.count("reactive") != 0) {
+            const int fps = options.count("fps") != 0 ? options["fps"].as<int>() : 60;
+            if (fps < 1 or fps > 1000) {
+                std::cerr << "Invalid frame rate, expected 1-1000\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            std::vector<rgb_keyboard::color> palette;
+            if (!select_profile(kbd, options) or !parse_palette(options, palette)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            rgb_keyboard::reactive_effects::effects effect = rgb_keyboard::reactive_effects::effects::ripple;
+            try {
+                if (options.count("reactive-effect") != 0)
+                    effect = rgb_keyboard::reactive_effects::parse_effect(options["reactive-effect"].as<std::string>());
+            } catch (std::invalid_argument&) {
+                std::cerr << "Unknown reactive effect '" << options["reactive-effect"].as<std::string>() << "'. Valid options are:\nfade ripple trail\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            rgb_keyboard::reactive_effects reactive(effect, kbd.get_key_geometry(), palette);
+
+            int layer = 0;
+            if (!setup_effect_layer(kbd, options, layer)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            // - is stdin
+            const auto& input = options["reactive"].as<std::string>();
+            const int fd = input == "-" ? 0 : open(input.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << "Couldn't open input device " << input << ", read access to /dev/input/event* usually requires the input group.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = reactive.play(kbd, fd, fps, interrupted, layer);
+            if (fd != 0)
+                close(fd);
+
+            std::cout << "Handled " << stats.presses << " key presses, sent " << stats.frames << " frames\n";
+            print_timing("Key to light latency", stats.latency);
+            print_timing("USB time", stats.transfer);
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // count key presses into a file and show them as a heatmap
+        if (options.count("heatmap") != 0) {
+            const int fps = options.count("fps") != 0 ? options["fps"].as<int>() : 1;
+            const double half_life = options.count("half-life") != 0 ? options["half-life"].as<double>() : 0;
+            if (fps < 1 or fps > 1000 or half_life < 0) {
+                std::cerr << "Invalid update rate or half life\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            std::vector<rgb_keyboard::color> palette;
+            if (!select_profile(kbd, options) or !parse_palette(options, palette)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            // half life in minutes
+            rgb_keyboard::typing_heatmap heatmap(kbd.get_key_geometry(), palette, std::chrono::milliseconds(static_cast<int64_t>(half_life * 60000)));
+            if (heatmap.open(options["heat-file"].as<std::string>()) != 0) {
+                std::cerr << "Couldn't open heatmap file.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            // - is stdin
+            const auto& input = options["heatmap"].as<std::string>();
+            const int fd = input == "-" ? 0 : open(input.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << "Couldn't open input device " << input << ", read access to /dev/input/event* usually requires the input group.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = heatmap.play(kbd, fd, fps, interrupted);
+            if (fd != 0)
+                close(fd);
+
+            std::cout << "Counted " << stats.presses << " key presses, " << stats.uploads << " of " << stats.renders << " updates sent " << stats.keys
+                      << " key colors\n";
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // show cpu, memory and temperature on the keys
+        if (options.count("monitor") != 0) {
+            const double interval = options.count("interval") != 0 ? options["interval"].as<double>() : 2;
+            if (interval < 0.01) {
+                std::cerr << "Invalid interval, expected at least 0.01 seconds\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            std::vector<rgb_keyboard::color> palette;
+            if (!select_profile(kbd, options) or !parse_palette(options, palette)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            rgb_keyboard::system_monitor monitor(palette);
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = monitor.play(kbd, std::chrono::milliseconds(static_cast<int64_t>(interval * 1000)), interrupted);
+
+            std::cout << "Took " << stats.samples << " samples, " << stats.uploads << " changed the colors\n";
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // show raw frames from stdin in the custom led mode
+        if (options.count("stream") != 0) {
+            rgb_keyboard::frame_stream::formats format;
+            try {
+                format = rgb_keyboard::frame_stream::parse_format(options["stream"].as<std::string>());
+            } catch (std::invalid_argument&) {
+                std::cerr << "Unknown frame format '" << options["stream"].as<std::string>() << "'. Valid options are:\nrgb24 ppm\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            // frame size: WIDTHxHEIGHT, only needed for rgb24
+            int width = 0, height = 0;
+            std::smatch size;
+            const std::string size_option = options.count("size") != 0 ? options["size"].as<std::string>() : "";
+            if (std::regex_match(size_option, size, std::regex("([0-9]{1,5})x([0-9]{1,5})"))) {
+                width = stoi(size[1]);
+                height = stoi(size[2]);
+            }
+            if (format == rgb_keyboard::frame_stream::formats::rgb24 and (width == 0 or height == 0)) {
+                std::cerr << "--stream rgb24 needs the frame size, e.g. --size 64x16\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            if (!select_profile(kbd, options)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            rgb_keyboard::frame_stream stream(format, width, height, kbd.get_key_geometry());
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = stream.play(kbd, interrupted);
+
+            std::cout << "Read " << stats.read << " frames, sent " << stats.sent << ", " << stats.unchanged << " unchanged, " << stats.dropped
+                      << " dropped\n";
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // show the spectrum of audio from stdin or a file
+        if (options.count("spectrum") != 0) {
+            rgb_keyboard::spectrum_visualizer::audio_format format;
+            if (options.count("sample-rate") != 0)
+                format.sample_rate = options["sample-rate"].as<int>();
+            if (options.count("channels") != 0)
+                format.channels = options["channels"].as<int>();
+            const int fps = options.count("fps") != 0 ? options["fps"].as<int>() : 30;
+            if (fps < 1 or fps > 1000 or format.sample_rate < 1000 or format.channels < 1 or format.channels > 32) {
+                std::cerr << "Invalid frame rate, sample rate or number of channels\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            std::vector<rgb_keyboard::color> palette;
+            if (!select_profile(kbd, options) or !parse_palette(options, palette)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            // - is stdin
+            const auto& input = options["spectrum"].as<std::string>();
+            const int fd = input == "-" ? 0 : open(input.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << "Couldn't open audio file.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            rgb_keyboard::spectrum_visualizer visualizer(fd, format, kbd.get_key_geometry(), palette, fps);
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = visualizer.play(kbd, interrupted);
+            if (fd != 0)
+                close(fd);
+
+            std::cout << std::fixed << std::setprecision(1) << "Sent " << stats.frames << " frames: " << stats.fps() << " fps (target " << fps
+                      << "), audio to light latency " << stats.latency_average() << " ms average, "
+                      << std::chrono::duration<double, std::milli>(stats.latency_max).count() << " ms maximum, plus "
+                      << std::chrono::duration<double, std::milli>(stats.window_delay).count() << " ms analysis window, " << stats.dropped
+                      << " frames dropped\n";
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // play a light show file
+        if (options.count("show") != 0) {
+            rgb_keyboard::light_show show;
+            if (show.load(options["show"].as<std::string>()) != 0) {
+                std::cerr << "Couldn't open light show file.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            if (!select_profile(kbd, options)) {
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            const auto stats = show.play(kbd, interrupted);
+
+            std::cout << "Played " << stats.frames << " frames with " << stats.uploads << " uploads (" << stats.merged << " frames merged), " << stats.keys
+                      << " key changes\n";
+            print_timing("Frame interval", stats.timing.interval);
+            print_timing("Wake up lateness", stats.timing.lateness);
+            print_timing("USB time", stats.timing.transfer);
+
+            kbd.close_keyboard();
+            return 0;
+        }
+
+        // send compiled packet program
+        if (options.count("apply") != 0) {
+            const auto& apply = options["apply"].as<std::string>();
+            rgb_keyboard::packet_program program;
+            if (program.load(apply) != 0) {
+                std::cerr << "Couldn't open packet program file.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            kbd.write_program(program);
+        }
+
+        // store all following packets for the optimizer
+        if (optimize and not compile)
+            kbd.begin_capture();
+
         // read settings from keyboard
-        if ((options.count("read") != 0) && (options.count("ajazzak33") != 0)) {
-            std::cout << "This feature is currently not supported for the Ajazz AK33\n";
+        if ((options.count("read") != 0) && !kbd.get_device_model().read_support) {
+            std::cout << "This feature is currently not supported for the " << kbd.get_device_model().name << "\n";
             std::cout << "You can help to implement it by capturing USB communication, for more information open an issue on Github.\n";
         } else if (options.count("read") != 0) {
             // a copy of the main kbd object, this prevents unintentional behaviour
@@ -397,6 +1098,18 @@ int main(int argc, char** argv) {
             kbd.write_custom();
         }
 
+        // parse pattern flag, the pattern is used directly from the library file
+        if (options.count("pattern") != 0) {
+            rgb_keyboard::pattern_library::pattern pattern;
+            if (!library.find(options["pattern"].as<std::string>(), pattern)) {
+                std::cerr << "Unknown pattern '" << options["pattern"].as<std::string>() << "'.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+            kbd.set_custom_colors(pattern.keys, pattern.colors, pattern.count);
+            kbd.write_custom();
+        }
+
         // parse color flag
         if (options.count("color") != 0) {
             const auto& color = options["color"].as<std::string>();
@@ -485,7 +1198,8 @@ int main(int argc, char** argv) {
         }
 
         // parse keymap flag
-        if ((options.count("keymap") != 0) and !(options.count("ajazzak33") != 0)) {
+        bool keymap_written = false;
+        if ((options.count("keymap") != 0) and kbd.get_device_model().keymap_offsets != nullptr) {
             const auto& keymap = options["keymap"].as<std::string>();
             // ask user for confirmation?
             std::cout << R"(Remapping the keys is experimental and potentially dangerous.
@@ -501,6 +1215,7 @@ Anything else will cancel this process.
             if (user_input == "YES") {
                 if (kbd.load_keymap(keymap) == 0) {
                     kbd.write_key_mapping_ansi();
+                    keymap_written = true;
                 } else {
                     std::cerr << "Couldn't open keymap file.\n";
                     kbd.close_keyboard();
@@ -511,6 +1226,92 @@ Anything else will cancel this process.
             }
         }
 
+        // reload the custom pattern and keymap whenever the files are saved
+        if (watch) {
+            rgb_keyboard::file_watcher watcher;
+            const auto& pattern_file = options["custom-pattern"].as<std::string>();
+            const int pattern_id = watcher.add(pattern_file);
+            // the keymap is only reloaded if the user accepted remapping above
+            const int keymap_id = keymap_written ? watcher.add(options["keymap"].as<std::string>()) : -1;
+            if (pattern_id < 0 or (keymap_written and keymap_id < 0)) {
+                std::cerr << "Couldn't watch files for changes.\n";
+                kbd.close_keyboard();
+                return 1;
+            }
+
+            // the pattern was sent before switching to the custom mode, the keyboard keeps displaying it
+            if (options.count("leds") != 0 and options["leds"].as<std::string>() == "custom")
+                kbd.assume_custom_written();
+
+            std::signal(SIGINT, interrupt_handler);
+            std::signal(SIGTERM, interrupt_handler);
+            std::cout << "Watching for changes, press Ctrl+C to stop.\n";
+
+            while (!interrupted) {
+                // wake up regularly to check for signals, editors write files in bursts: wait until they are done
+                const auto changed = watcher.wait(std::chrono::milliseconds(100), std::chrono::milliseconds(20));
+
+                for (int id : changed) {
+                    if (id == pattern_id) {
+                        // reparse the pattern, write_custom() only sends keys that differ from the last write
+                        const rgb_keyboard::key_framebuffer previous = kbd.get_custom_colors();
+                        try {
+                            kbd.set_custom_pattern({});
+                            if (kbd.load_custom(pattern_file) != 0) {
+                                std::cerr << "Couldn't open custom pattern file.\n";
+                                kbd.set_custom_pattern(previous);
+                                continue;
+                            }
+                            if (options.count("custom-keys") != 0)
+                                kbd.set_custom_keys(options["custom-keys"].as<std::string>());
+                        } catch (std::invalid_argument& e) {
+                            std::cerr << "Invalid custom pattern: " << e.what() << "\n";
+                            kbd.set_custom_pattern(previous);
+                            continue;
+                        }
+                        // keys removed from the pattern are turned off
+                        kbd.set_custom_colors(previous.keys() - kbd.get_custom_colors().keys(), {0x00, 0x00, 0x00});
+                        kbd.write_custom();
+                    } else if (id == keymap_id) {
+                        try {
+                            kbd.clear_keymap();
+                            if (kbd.load_keymap(options["keymap"].as<std::string>()) == 0)
+                                kbd.write_key_mapping_ansi();
+                            else
+                                std::cerr << "Couldn't open keymap file.\n";
+                        } catch (std::exception& e) {
+                            std::cerr << "Invalid keymap: " << e.what() << "\n";
+                        }
+                    }
+                }
+            }
+        }
+
+        // optimize captured packets
+        std::vector<rgb_keyboard::packet> packets;
+        if (compile or optimize)
+            packets = kbd.end_capture();
+        if (optimize) {
+            auto stats = rgb_keyboard::packet_optimizer::optimize(packets);
+            std::cout << "Optimized " << stats.packets_in << " packets to " << stats.packets_out << " packets (" << stats.saved() << " saved)\n";
+            if (!stats.equivalent)
+                std::cerr << "Optimized packets are not equivalent, sending unoptimized packets\n";
+        }
+        rgb_keyboard::packet_program program(kbd.get_device_model().program_model, kbd.get_profile(), std::move(packets));
+
+        // store compiled packet program
+        if (compile) {
+            const auto& file = options["compile"].as<std::string>();
+            if (program.save(file) != 0) {
+                std::cerr << "Couldn't write packet program file.\n";
+                return 1;
+            }
+            std::cout << "Compiled " << program.size() << " packets into " << file << "\n";
+        } else if (optimize) {
+            // send optimized packets
+            kbd.write_program(program);
+        }
+
         // catch exception
     } catch (std::exception& e) {
         std::cerr << "Caught exception: " << e.what() << "\n";
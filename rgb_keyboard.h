@@ -4,17 +4,29 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
 #include <deque>
 #include <exception>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <regex>
 #include <string>
 #include <vector>
 
 #include <libusb-1.0/libusb.h>
 
+#include "color_calibration.h"
+#include "compositor.h"
+#include "device_models.h"
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+#include "key_selector.h"
 #include "macro.h"
+#include "overlay_stack.h"
+#include "packet_program.h"
+#include "pcapng_writer.h"
+#include "static_table.h"
 
 namespace rgb_keyboard {
 
@@ -80,9 +92,16 @@ namespace rgb_keyboard {
 
         // setter functions: set values for current _profile
         /** Enable/disable Ajazz AK33 compatibility mode.
-         * This changes the way data is send, the USB PID, the maximum brightness, etc.
+         * This forces the Ajazz AK33 model policy (control transfers, maximum brightness, ...)
+         * instead of selecting the model by USB PID when the keyboard is opened.
          */
         void set_ajazzak33_compatibility(bool compatibility);
+        /** Select the model policy used for sending data and checking values
+         * This is done automatically when opening the keyboard, unless Ajazz AK33 compatibility is enabled.
+         * \param selected device_model_of one of the model_policies
+         * \throws std::invalid_argument if selected doesn't describe one of the model_policies
+         */
+        void select_model(const device_model& selected);
         /** Set the profile to which settings are applied with set_*()
          * \param profile 1-3
          * \return 0 if successful, 1 if invalid argument
@@ -108,10 +127,66 @@ namespace rgb_keyboard {
         void set_rainbow(bool rainbow);
         /// Set the variant of the reactive_color led mode
         void set_variant(mode_variants variant);
-        /// Set custom color of individual keys
-        void set_custom_keys(std::string keys);
+        /** Set custom color of individual keys
+         * \throws std::invalid_argument if keys is malformed
+         * \see parse_custom_keys()
+         */
+        void set_custom_keys(std::string_view keys);
+        /** Parse custom key colors ("key=rrggbb;key=rrggbb;"), keys can be key selectors
+         * \throws std::invalid_argument with the position of every malformed entry
+         * \see parse_key_selector()
+         */
+        [[nodiscard]] static key_framebuffer parse_custom_keys(std::string_view keys);
+        /** Set the custom color of count keys
+         * \param keys Key indices, see get_led_key_index()
+         * \param colors One color for each key
+         */
+        void set_custom_colors(const uint8_t* keys, const color* colors, std::size_t count);
+        /// Set the custom color of all keys in a key set
+        void set_custom_colors(const key_set& keys, const color& value);
+        /// Replace all custom key colors of the current profile, keys not set in colors are no longer sent by write_custom()
+        void set_custom_pattern(const key_framebuffer& colors);
+        /// Remove all key remappings of the current profile
+        void clear_keymap();
+        /** Show temporary key colors on top of the custom pattern of the current profile
+         * Overlays added later are shown on top. Only the overlaid keys are sent by write_custom(),
+         * when the overlay is removed or expires they are restored to the color below.
+         * \param colors Keys and colors of the overlay
+         * \param period Blink period, 0 for a steady overlay
+         * \param ttl Time to live, 0 if the overlay is only removed with remove_overlay()
+         * \return Id of the overlay
+         * \see write_custom()
+         */
+        int add_overlay(const key_framebuffer& colors, std::chrono::milliseconds period = {}, std::chrono::milliseconds ttl = {});
+        /// Remove an overlay of the current profile
+        void remove_overlay(int id);
+        /// Remove all overlays of the current profile
+        void clear_overlays();
+        /** Add a layer between the custom pattern and the overlays of the current profile
+         * Layers are blended on top of the custom pattern, layers added later on top. A new layer is transparent.
+         * \param mode Blend mode of the layer
+         * \param opacity Opacity of the layer, 0 - 255
+         * \return Id of the layer
+         * \see compositor
+         */
+        int add_layer(compositor::blend_modes mode = compositor::blend_modes::normal, uint8_t opacity = 255);
+        /// Set the colors of a layer of the current profile, keys without a color are transparent
+        void set_layer(int id, const key_framebuffer& colors);
+        /** Set the colors and alpha values of a layer of the current profile
+         * \param alpha max_keys alpha values (0 - 255), indexed by the key index
+         */
+        void set_layer(int id, const key_framebuffer& colors, const uint8_t* alpha);
+        /// Remove a layer of the current profile
+        void remove_layer(int id);
+        /** Declare that the keyboard already displays the custom pattern of the current profile with all layers and visible overlays
+         * Nothing is sent, the next write_custom() only sends changes. Use this if the pattern
+         * was written earlier, e.g. by another process.
+         */
+        void assume_custom_written();
         /// Set the USB poll rate
         void set_report_rate(report_rates report_rate);
+        /// Set the color calibration applied to all colors sent to the keyboard
+        void set_calibration(const color_calibration& calibration);
         /// Set whether to detach the kernel driver for the keyboard
         void set_detach_kernel_driver(bool detach_kernel_driver);
         /// Set whether to open USB interface 0
@@ -146,8 +221,35 @@ namespace rgb_keyboard {
         [[nodiscard]] int get_active_profile() const;
         /// Get profile to which settings are applied
         [[nodiscard]] int get_profile() const;
-        /// Get whether Ajazz AK33 compatibility is enabled
+        /// Get whether the Ajazz AK33 model policy is used
         [[nodiscard]] bool get_ajazzak33_compatibility() const;
+        /// Get the description of the selected model policy
+        [[nodiscard]] const device_model& get_device_model() const;
+        /// Get the key index of a key name for custom led patterns, -1 if the name is unknown
+        [[nodiscard]] static int get_led_key_index(std::string_view name);
+        /// Returns true if name is a physical key that can be remapped
+        [[nodiscard]] static bool get_keymap_key_valid(std::string_view name);
+        /// Returns true if name is a key function (or macro1-macro100) a key can be remapped to
+        [[nodiscard]] static bool get_keymap_option_valid(std::string_view name);
+        /// Get the physical key positions of the led layout of the selected model
+        [[nodiscard]] const key_geometry& get_key_geometry() const;
+        /// Get the custom key colors of the current profile
+        [[nodiscard]] const key_framebuffer& get_custom_colors() const;
+        /// Returns true if the current profile has overlays
+        [[nodiscard]] bool get_overlays_active() const;
+        /// Get the next time an overlay of the current profile blinks or expires, write_custom() has to be called then
+        [[nodiscard]] overlay_stack::clock::time_point get_next_overlay_change() const;
+        /// Get the color calibration
+        [[nodiscard]] const color_calibration& get_calibration() const;
+        /// Get the USB serial number of the opened keyboard, empty if unknown
+        [[nodiscard]] const std::string& get_serial() const;
+        /// Get the measured average time of a packet transfer, 0 before the first transfer
+        [[nodiscard]] std::chrono::nanoseconds get_packet_time() const;
+        /** Get the frame rate the keyboard can sustain in the custom led mode, measured from the packet transfers
+         * \param keys Number of keys changing in each frame
+         * \return 0 before the first transfer
+         */
+        [[nodiscard]] double get_sustainable_fps(std::size_t keys) const;
 
         // writer functions (apply settings to keyboard)
         /// Write the brightness to the keyboard
@@ -160,8 +262,19 @@ namespace rgb_keyboard {
         int write_direction();
         /// Write the LED color to the keyboard
         int write_color();
-        /// Write the custom LED pattern to the keyboard
+        /** Write the custom LED pattern with all layers and visible overlays to the keyboard
+         * Only keys whose color differs from the last pattern written to the current profile are sent,
+         * a single changed key needs three packets. The first write after opening the keyboard,
+         * changing the mode or the active profile sends all keys.
+         * \see invalidate_custom()
+         */
         int write_custom();
+        /** Write the custom LED pattern, then switch the current profile to the custom LED mode
+         * The keyboard keeps displaying the pattern when the mode changes, so the following
+         * write_custom() calls only send changes.
+         * \return 0 if successful
+         */
+        int write_custom_mode();
         /// Write the reactive_color variant to the keyboard
         int write_variant();
         /// Write the USB poll rate to the keyboard
@@ -170,6 +283,11 @@ namespace rgb_keyboard {
         int write_key_mapping_ansi();
         /// Write the active profile to the keyboard
         int write_active_profile();
+        /** Send a compiled packet program to the keyboard
+         * The packets are sent unmodified, the program must have been compiled for the same keyboard model.
+         * \return 0 if successful
+         */
+        int write_program(const packet_program& program);
 
         // reader functions
         /// Read the active profile from the keyboard
@@ -182,8 +300,7 @@ namespace rgb_keyboard {
 
         // helper functions
         /** Initialize libusb and open keyboard by USB VID and USB PID
-         * \see _keyboard_vid
-         * \see _keyboard_pid
+         * Each product id in device_registry is tried, the model policy is selected by the product id.
          * \return 0 if successful
          */
         int open_keyboard();
@@ -191,12 +308,32 @@ namespace rgb_keyboard {
          * \return 0 if successful
          */
         int open_keyboard_bus_device(uint8_t bus, uint8_t device);
+        /** Open a simulated keyboard that records all transfers to a pcapng file instead of sending them
+         * No USB device is accessed, read_*() functions receive packets filled with zeroes.
+         * \param bus USB bus number stored in the capture
+         * \param device USB device address stored in the capture
+         * \return 0 if successful
+         */
+        int open_dry_run(const std::string& file, uint8_t bus = 1, uint8_t device = 1);
         /// Close the keyboard and libusb
         int close_keyboard();
+        /** Start capturing packets
+         * While capturing, the write_*() functions store their packets instead of sending them,
+         * no keyboard needs to be opened.
+         * \see end_capture()
+         */
+        void begin_capture();
+        /// Stop capturing packets and return all packets captured since begin_capture()
+        std::vector<packet> end_capture();
+        /** Forget which custom colors the keyboard displays, the next write_custom() sends all keys
+         * Use this if the keyboard was changed by other software.
+         */
+        void invalidate_custom();
 
         // loader functions (read settings from file)
         /** Load custom led pattern from the specified file
-         * \return 0 if successful
+         * \return 0 if successful, 1 if the file can't be read
+         * \throws std::invalid_argument with the position of every malformed line
          * \see write_custom()
          */
         int load_custom(std::string File);
@@ -204,6 +341,11 @@ namespace rgb_keyboard {
          * \return 0 if successful
          */
         int load_keymap(std::string File);
+        /** Load the color calibration for the opened keyboard from the specified file
+         * \return 0 if successful
+         * \see color_calibration::load()
+         */
+        int load_calibration(const std::string& file);
 
         // prints all valid keycodes
         /// Print all valid key names for custom led patterns to stdout
@@ -214,13 +356,48 @@ namespace rgb_keyboard {
         static int print_keycodes_options();
 
      private:
-        /// Wrapper around libusb for sending data
+        /// Send data with the transport selected for the model
         int write_data(const unsigned char* data, int length);
-
-        /** If this is variable is set to true, usb control transfers are used for sending data.
-         *  This enables compatibility with other keyboards (Ajazz AK 33).
-         */
-        bool ajazzak33Compatibility = false;
+        /// Wrapper around libusb for sending a read request and receiving the response (64 bytes)
+        int read_data(const unsigned char* data, unsigned char* buffer);
+        /// Read the USB serial number of the opened keyboard into serial
+        void read_serial();
+
+        /// Select the transport for write_data() (usb, dry run or capture)
+        void update_transport();
+        /// Transport: send data to the keyboard
+        template <typename transfer>
+        int write_usb(const unsigned char* data, int length);
+        /// Transport: record data to the dry run capture
+        template <typename transfer>
+        int write_dry_run(const unsigned char* data, int length);
+        /// Transport: store data in captured_packets
+        int write_capture(const unsigned char* data, int length);
+
+        /// Pointer to a transport function
+        using transport_function = int (keyboard::*)(const unsigned char* data, int length);
+        /// The transports instantiated for the transfer method of a model policy
+        struct model_transports {
+            const device_model* model;
+            transport_function usb;
+            transport_function dry_run;
+        };
+        /// Build model_table from a list of model policies
+        template <typename... policies>
+        static std::array<model_transports, sizeof...(policies)> make_model_table(const std::tuple<policies...>*);
+        /// The transports of all model_policies, select_model() looks the selected model up here
+        static const std::array<model_transports, std::tuple_size_v<model_policies>> model_table;
+        /// Transport used by write_data()
+        transport_function transport = nullptr;
+        /// USB transport for the selected model
+        transport_function usb_transport = nullptr;
+        /// Dry run transport for the selected model
+        transport_function dry_run_transport = nullptr;
+
+        /// Selected model policy
+        const device_model* model = &device_model_of<standard_model>;
+        /// If true, the model is not selected by product id when opening the keyboard
+        bool model_forced = false;
 
         /// Profile (1-3): this determines the profile to which the settings are applied
         int profile;
@@ -250,37 +427,11 @@ namespace rgb_keyboard {
         /// USB poll rate
         std::array<report_rates, 3> report_rate;
 
-        // min and max values
+        // min values, the max values depend on the model
         /// Minimum value for brightness
         const int brightness_min = 0;
-        /// Maximum value for brightness for the Ajazz AK 33
-        const int brightness_max_ajazzak33 = 5;
-        /// Maximum value for brightness for keyboards except the Ajazz AK 33
-        const int brightness_max_others = 9;
-        /// Maximum value for brightness (this is not constant, the Ajazz AK33 has a different value)
-        int brightness_max = brightness_max_others;
         /// Minimum led pattern animation speed
         const int speed_min = 0;
-        /// Maximum led pattern animation speed
-        const int speed_max = 3;
-
-        // usb device vars
-        /// USB vendor id
-        const uint16_t keyboard_vid = 0x0c45;
-
-        // TODO! rewrite this
-        /// USB product id for the Ajazz AK33
-        static constexpr std::array<uint16_t, 5> keyboard_pid_ajazzak33 = {0x7903, 0x5204, 0x5104, 0x5004, 0x8520};
-        /** USB product ids for other keyboards
-         * Tecware Phantom, GMMK = 0x652f
-         * Redragon K550 Yama = 0x5204
-         * Redragon K552 Kumara = 0x5104
-         * Redragon K556 Devarajas = 0x5004
-         * Warrior Kane TC235 = 0x8520
-         */
-        static constexpr std::array<uint16_t, 5> keyboard_pid_others = {0x5204, 0x5104, 0x5004, 0x8520, 0x652f};
-        /// USB product id, this is not constant as the Ajazz AK33 has a different PID
-        std::array<uint16_t, 5> keyboard_pid = keyboard_pid_others;
 
         /// If true, try to detach the kernel driver when opening the keyboard
         bool detach_kernel_driver = true;
@@ -295,6 +446,22 @@ namespace rgb_keyboard {
 
         /// libusb device handle
         libusb_device_handle* handle = nullptr;
+        /// USB serial number of the opened keyboard
+        std::string serial;
+
+        /// Color calibration for the opened keyboard
+        color_calibration calibration;
+
+        /// Moving average of the duration of write_data()
+        std::chrono::nanoseconds packet_time{};
+
+        /// If true, write_data() stores packets in captured_packets instead of sending them
+        bool capture = false;
+        /// Packets stored while capturing
+        std::vector<packet> captured_packets;
+
+        /// If set, transfers are recorded to this file instead of being sent (--dry-run)
+        std::shared_ptr<pcapng_writer> dry_run;
 
         // usb data packets
         constexpr static uint8_t data_start[] = {0x04, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
@@ -416,15 +583,19 @@ namespace rgb_keyboard {
                                                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
                                                 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
 
-        /// Stores the key names for custom key colors
-        const static std::map<std::string_view, std::array<uint8_t, 3>> keycodes;
         /// Stores custom key colors
-        std::array<std::map<std::string, std::array<uint8_t, 3>>, 3> key_colors;
+        std::array<key_framebuffer, 3> key_colors;
+        /// Custom key colors the keyboard is known to display
+        std::array<key_framebuffer, 3> key_colors_shadow;
+        /// Is key_colors_shadow up to date?
+        std::array<bool, 3> key_colors_shadow_valid{};
+        /// Layers blended on top of key_colors
+        std::array<compositor, 3> layers;
+        /// Overlays on top of the layers
+        std::array<overlay_stack, 3> overlays;
 
-        /// Offsets for key remapping ( key → data positon ) ["string":[ [x,y], [x,y], [x,y] ]]
-        const static std::map<std::string_view, std::array<std::array<uint8_t, 2>, 3>> keymap_offsets;
         /// Keymap options (what a key can do when pressed)  ( option → code )
-        const static std::map<std::string_view, std::array<uint8_t, 3>> keymap_options;
+        const static static_table<std::array<uint8_t, 3>, 195>& keymap_options;
         /// Stores current keymapping ( key → option)
         std::array<std::map<std::string, std::string>, 3> keymap;
 
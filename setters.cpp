@@ -1,14 +1,14 @@
 #include "rgb_keyboard.h"
 
+#include "pattern_parser.h"
+
 void rgb_keyboard::keyboard::set_ajazzak33_compatibility(bool compatibility) {
-    this->ajazzak33Compatibility = compatibility;
+    model_forced = compatibility;
 
     if (compatibility) {
-        keyboard_pid = keyboard_pid_ajazzak33;      // different PID
-        brightness_max = brightness_max_ajazzak33;  // different maximum brightness
+        select_model(device_model_of<ajazzak33_model>);  // control transfers, different maximum brightness
     } else {
-        keyboard_pid = keyboard_pid_others;
-        brightness_max = brightness_max_others;
+        select_model(device_model_of<standard_model>);
     }
 }
 
@@ -21,7 +21,7 @@ void rgb_keyboard::keyboard::set_direction(directions direction) {
 }
 
 void rgb_keyboard::keyboard::set_speed(int speed) {
-    if (speed >= speed_min && speed <= speed_max) {
+    if (speed >= speed_min && speed <= model->speed_max) {
         this->speed[profile - 1] = speed;
     } else {
         throw std::runtime_error("Speed not in valid range.");
@@ -29,7 +29,7 @@ void rgb_keyboard::keyboard::set_speed(int speed) {
 }
 
 void rgb_keyboard::keyboard::set_brightness(int brightness) {
-    if (brightness >= brightness_min && brightness <= brightness_max) {
+    if (brightness >= brightness_min && brightness <= model->brightness_max) {
         this->brightness[profile - 1] = brightness;
     } else {
         throw std::runtime_error("Brightness not in valid range.");
@@ -50,34 +50,95 @@ void rgb_keyboard::keyboard::set_variant(mode_variants variant) {
     this->variant[profile - 1] = variant;
 }
 
-void rgb_keyboard::keyboard::keyboard::set_custom_keys(std::string keys) {
-    std::size_t position1;
-
-    while ((position1 = keys.find('=')) != std::string::npos) {
-        std::size_t position2 = keys.find(';');
-        if (position2 != std::string::npos) {
-            auto value1 = keys.substr(0, position1);
-            auto value2 = keys.substr(position1 + 1, position2 - position1 - 1);
-            keys.erase(0, position2 + 1);
-
-            // store values in map
-            if (value2.length() == 6) {
-                uint8_t val_r = stoi(value2.substr(0, 2), nullptr, 16);
-                uint8_t val_g = stoi(value2.substr(2, 2), nullptr, 16);
-                uint8_t val_b = stoi(value2.substr(4, 2), nullptr, 16);
-                std::array<uint8_t, 3> val_rgb = {val_r, val_g, val_b};
-                key_colors[profile - 1][value1] = val_rgb;
-            }
-        } else {
-            break;
-        }
-    }
+rgb_keyboard::key_framebuffer rgb_keyboard::keyboard::parse_custom_keys(std::string_view keys) {
+    key_framebuffer result;
+
+    auto diagnostics = parse_pattern(keys, pattern_syntax::keys, result);
+    if (!diagnostics.empty())
+        throw std::invalid_argument(format_diagnostics("custom keys", diagnostics));
+
+    return result;
+}
+
+void rgb_keyboard::keyboard::keyboard::set_custom_keys(std::string_view keys) {
+    key_colors[profile - 1].merge(parse_custom_keys(keys));
+}
+
+void rgb_keyboard::keyboard::set_custom_colors(const uint8_t* keys, const color* colors, std::size_t count) {
+    key_colors[profile - 1].set(keys, colors, count);
+}
+
+void rgb_keyboard::keyboard::set_custom_colors(const key_set& keys, const color& value) {
+    key_colors[profile - 1].set(keys, value);
+}
+
+void rgb_keyboard::keyboard::set_custom_pattern(const key_framebuffer& colors) {
+    key_colors[profile - 1] = colors;
+}
+
+void rgb_keyboard::keyboard::clear_keymap() {
+    keymap[profile - 1].clear();
+}
+
+int rgb_keyboard::keyboard::add_overlay(const key_framebuffer& colors, std::chrono::milliseconds period, std::chrono::milliseconds ttl) {
+    // colors displayed below the overlay: known from the last write, otherwise from the pattern, otherwise off
+    key_framebuffer displayed;
+    colors.for_each([&](int key) {
+        if (key_colors_shadow_valid[profile - 1] && key_colors_shadow[profile - 1].is_set(key))
+            displayed.set(key, key_colors_shadow[profile - 1].get(key));
+        else if (key_colors[profile - 1].is_set(key))
+            displayed.set(key, key_colors[profile - 1].get(key));
+        else
+            displayed.set(key, color{0x00, 0x00, 0x00});
+    });
+
+    return overlays[profile - 1].add(colors, displayed, period, ttl);
+}
+
+void rgb_keyboard::keyboard::remove_overlay(int id) {
+    overlays[profile - 1].remove(id);
+}
+
+void rgb_keyboard::keyboard::clear_overlays() {
+    overlays[profile - 1].clear();
+}
+
+int rgb_keyboard::keyboard::add_layer(compositor::blend_modes mode, uint8_t opacity) {
+    return layers[profile - 1].add_layer(mode, opacity);
+}
+
+void rgb_keyboard::keyboard::set_layer(int id, const key_framebuffer& colors) {
+    layers[profile - 1].set_layer(id, colors);
+}
+
+void rgb_keyboard::keyboard::set_layer(int id, const key_framebuffer& colors, const uint8_t* alpha) {
+    layers[profile - 1].set_layer(id, colors, alpha);
+}
+
+void rgb_keyboard::keyboard::remove_layer(int id) {
+    layers[profile - 1].remove_layer(id);
+}
+
+void rgb_keyboard::keyboard::assume_custom_written() {
+    // the same colors write_custom() would send
+    const key_framebuffer& pattern = layers[profile - 1].empty() ? key_colors[profile - 1] : layers[profile - 1].compose(key_colors[profile - 1]);
+    overlays[profile - 1].expire();
+    key_colors_shadow[profile - 1] = overlays[profile - 1].compose(pattern);
+    key_colors_shadow_valid[profile - 1] = true;
+    overlays[profile - 1].restored();
 }
 
 void rgb_keyboard::keyboard::set_report_rate(report_rates report_rate) {
     this->report_rate[profile - 1] = report_rate;
 }
 
+void rgb_keyboard::keyboard::set_calibration(const color_calibration& calibration) {
+    this->calibration = calibration;
+
+    // the displayed colors no longer match the calibrated colors
+    invalidate_custom();
+}
+
 void rgb_keyboard::keyboard::set_profile(int profile) {
     this->profile = profile;
 }
@@ -0,0 +1,301 @@
+#include "spectrum.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+#include "input_read.h"
+#include "rgb_keyboard.h"
+
+namespace {
+    // number of frequency bands spread over the key columns
+    constexpr int band_count = 20;
+    // the analysis block covers at least this time, in seconds
+    constexpr float block_time = 0.04f;
+    // displayed levels fall by this much per second
+    constexpr float falloff = 1.5f;
+
+    constexpr float pi = 3.14159265358979f;
+
+    using rgb_keyboard::color;
+    constexpr color bar_palette[] = {{0x00, 0xff, 0x00}, {0xff, 0xff, 0x00}, {0xff, 0x00, 0x00}};
+
+    uint32_t read_le(const uint8_t* data, int bytes) {
+        uint32_t value = 0;
+        for (int i = bytes - 1; i >= 0; i--)
+            value = (value << 8) | data[i];
+        return value;
+    }
+}  // namespace
+
+rgb_keyboard::spectrum_analyzer::spectrum_analyzer(int size, int bands, float sample_rate, float min_frequency, float max_frequency) : n(size) {
+    if (size < 8 || (size & (size - 1)) != 0)
+        throw std::invalid_argument("FFT size must be a power of 2");
+    const int half = n / 2;
+
+    window.resize(n);
+    float window_sum = 0;
+    for (int i = 0; i < n; i++) {
+        window[i] = 0.5f - 0.5f * std::cos(2 * pi * i / n);
+        window_sum += window[i];
+    }
+    // a full scale sine has the amplitude window_sum / 2 in its bin
+    reference = window_sum * window_sum / 4;
+
+    twiddles.resize(half);
+    for (int k = 0; k < half; k++)
+        twiddles[k] = std::polar(1.0f, -2 * pi * k / n);
+
+    int bits = 0;
+    while ((1 << bits) < half)
+        bits++;
+    bit_reverse.resize(half);
+    for (int i = 0; i < half; i++) {
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < bits; bit++)
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        bit_reverse[i] = reversed;
+    }
+    buffer.resize(half);
+
+    // logarithmically spaced band edges, every band has at least one bin
+    max_frequency = std::min(max_frequency, sample_rate / 2);
+    band_edges.resize(bands + 1);
+    band_edges[0] = std::max(1, static_cast<int>(std::lround(min_frequency * n / sample_rate)));
+    for (int b = 1; b <= bands; b++) {
+        float frequency = min_frequency * std::pow(max_frequency / min_frequency, static_cast<float>(b) / bands);
+        band_edges[b] = std::max(band_edges[b - 1] + 1, static_cast<int>(std::lround(frequency * n / sample_rate)));
+    }
+    for (auto& edge : band_edges)
+        edge = std::min(edge, half);
+}
+
+void rgb_keyboard::spectrum_analyzer::fft() {
+    const int half = n / 2;
+    for (int size = 2; size <= half; size *= 2) {
+        // e^(-2πik/size) is twiddles[k * n / size]
+        const int step = n / size;
+        const int span = size / 2;
+        for (int start = 0; start < half; start += size) {
+            for (int k = 0; k < span; k++) {
+                std::complex<float> t = twiddles[k * step] * buffer[start + k + span];
+                std::complex<float> u = buffer[start + k];
+                buffer[start + k] = u + t;
+                buffer[start + k + span] = u - t;
+            }
+        }
+    }
+}
+
+void rgb_keyboard::spectrum_analyzer::analyze(const float* samples, float* levels) {
+    const int half = n / 2;
+
+    // pack pairs of real samples into complex values
+    for (int i = 0; i < half; i++)
+        buffer[bit_reverse[i]] = {samples[2 * i] * window[2 * i], samples[2 * i + 1] * window[2 * i + 1]};
+    fft();
+
+    for (int b = 0; b < bands(); b++) {
+        float peak = 0;
+        for (int k = band_edges[b]; k < band_edges[b + 1]; k++) {
+            // split the transform of the packed values into the spectrum of the real samples
+            std::complex<float> z = buffer[k];
+            std::complex<float> mirrored = std::conj(buffer[(half - k) % half]);
+            std::complex<float> even = 0.5f * (z + mirrored);
+            std::complex<float> odd = std::complex<float>(0, -0.5f) * (z - mirrored);
+            peak = std::max(peak, std::norm(even + twiddles[k] * odd));
+        }
+
+        float db = 10 * std::log10(peak / reference + 1e-12f);
+        levels[b] = std::clamp(1 + db / range_db, 0.0f, 1.0f);
+    }
+}
+
+double rgb_keyboard::spectrum_visualizer::statistics::fps() const {
+    auto seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0 ? frames / seconds : 0;
+}
+
+double rgb_keyboard::spectrum_visualizer::statistics::latency_average() const {
+    return frames != 0 ? std::chrono::duration<double, std::milli>(latency_total).count() / frames : 0;
+}
+
+rgb_keyboard::spectrum_visualizer::spectrum_visualizer(int fd, audio_format format, const key_geometry& geometry, const std::vector<color>& palette,
+                                                       int fps)
+    : fd(fd), format(format), geometry(geometry), fps(fps) {
+    struct stat status {};
+    is_file = fstat(fd, &status) == 0 && S_ISREG(status.st_mode);
+
+    // bands from left to right, a key lights up when the bar reaches its center
+    const auto colors = animation::make_palette(palette.empty() ? std::vector<color>(std::begin(bar_palette), std::end(bar_palette)) : palette);
+    for (int key = 0; key < max_keys; key++) {
+        if (!geometry.keys.test(key))
+            continue;
+        key_band[key] = std::min(band_count - 1, static_cast<int>(geometry.x[key] / geometry.width * band_count));
+        key_threshold[key] = (geometry.height - geometry.y[key]) / geometry.height;
+        int index = std::clamp(static_cast<int>(key_threshold[key] * 255 + 0.5f), 0, 255);
+        for (int channel = 0; channel < 3; channel++)
+            key_color[channel][key] = colors[channel][index];
+    }
+}
+
+bool rgb_keyboard::spectrum_visualizer::read_bytes(uint8_t* out, std::size_t size, const volatile std::sig_atomic_t& stop) {
+    // bytes of raw input read while looking for a header
+    if (!pending.empty()) {
+        std::size_t count = std::min(size, pending.size());
+        std::memcpy(out, pending.data(), count);
+        pending.erase(pending.begin(), pending.begin() + count);
+        out += count;
+        size -= count;
+    }
+
+    while (size > 0) {
+        std::size_t count = read_input(fd, out, size, stop);
+        if (count == 0)
+            return false;
+        out += count;
+        size -= count;
+    }
+    return true;
+}
+
+std::size_t rgb_keyboard::spectrum_visualizer::available() const {
+    int bytes = 0;
+    if (is_file || ioctl(fd, FIONREAD, &bytes) != 0)
+        return 0;
+    return bytes;
+}
+
+void rgb_keyboard::spectrum_visualizer::read_header(const volatile std::sig_atomic_t& stop) {
+    uint8_t riff[12];
+    if (!read_bytes(riff, sizeof(riff), stop))
+        return;
+    if (std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        pending.assign(riff, riff + sizeof(riff));
+        return;
+    }
+
+    // chunks up to the sample data
+    bool has_format = false;
+    uint8_t chunk[8];
+    while (read_bytes(chunk, sizeof(chunk), stop)) {
+        uint32_t size = read_le(chunk + 4, 4);
+        if (std::memcmp(chunk, "data", 4) == 0) {
+            if (!has_format)
+                throw std::invalid_argument("Invalid WAV file, the format chunk is missing");
+            return;
+        }
+
+        if (size > 1024 * 1024)
+            throw std::invalid_argument("Invalid WAV file, chunk too large");
+        std::vector<uint8_t> data(size + (size & 1));
+        if (!read_bytes(data.data(), data.size(), stop))
+            break;
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            // 1: PCM, 0xfffe: extensible
+            uint32_t tag = size >= 16 ? read_le(data.data(), 2) : 0;
+            if ((tag != 1 && tag != 0xfffe) || read_le(data.data() + 14, 2) != 16)
+                throw std::invalid_argument("Unsupported WAV file, expected 16 bit PCM");
+            format.channels = read_le(data.data() + 2, 2);
+            format.sample_rate = read_le(data.data() + 4, 4);
+            has_format = true;
+        }
+    }
+    throw std::invalid_argument("Invalid WAV file, no sample data");
+}
+
+void rgb_keyboard::spectrum_visualizer::render(const float* levels, key_framebuffer& colors) {
+    for (int i = 0; i < max_keys; i++) {
+        uint8_t lit = levels[key_band[i]] >= key_threshold[i] ? 0xff : 0;
+        channels[0][i] = key_color[0][i] & lit;
+        channels[1][i] = key_color[1][i] & lit;
+        channels[2][i] = key_color[2][i] & lit;
+    }
+    colors.set(geometry.keys, channels[0].data(), channels[1].data(), channels[2].data());
+}
+
+rgb_keyboard::spectrum_visualizer::statistics rgb_keyboard::spectrum_visualizer::play(keyboard& kbd, const volatile std::sig_atomic_t& stop) {
+    statistics stats;
+    read_header(stop);
+    if (format.sample_rate < 1000 || format.channels < 1)
+        throw std::invalid_argument("Unsupported audio format");
+
+    // all buffers are allocated here, the loop doesn't allocate memory
+    const int hop = std::max(1, format.sample_rate / fps);
+    int block = 8;
+    while (block < format.sample_rate * block_time)
+        block *= 2;
+    spectrum_analyzer analyzer(block, band_count, format.sample_rate);
+    hop_samples.assign(static_cast<std::size_t>(hop) * format.channels, 0);
+    history.assign(block, 0);
+    levels.assign(band_count, 0);
+    display.assign(band_count, 0);
+    key_framebuffer frame;
+
+    const std::size_t hop_bytes = hop_samples.size() * sizeof(int16_t);
+    const auto hop_duration = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(static_cast<double>(hop) / format.sample_rate));
+    stats.window_delay = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(block / 2.0 / format.sample_rate));
+    const float scale = 1.0f / (32768.0f * format.channels);
+    const int keep = std::max(0, block - hop);
+    const int first_kept = hop - (block - keep);
+
+    bool custom_mode = false;
+    const auto start = clock::now();
+    for (clock::rep hops = 1; !stop; hops++) {
+        // the samples are little endian like the host
+        if (!read_bytes(reinterpret_cast<uint8_t*>(hop_samples.data()), hop_bytes, stop))
+            break;
+        const auto arrival = clock::now();
+
+        // shift the history and append the hop as mono samples
+        std::memmove(history.data(), history.data() + (block - keep), keep * sizeof(float));
+        for (int i = first_kept; i < hop; i++) {
+            int sum = 0;
+            for (int channel = 0; channel < format.channels; channel++)
+                sum += hop_samples[i * format.channels + channel];
+            history[keep + i - first_kept] = sum * scale;
+        }
+
+        // a file plays in real time, a pipe delivers the samples in real time
+        const auto due = start + hops * hop_duration;
+        if (is_file) {
+            if (arrival > due + hop_duration) {
+                stats.dropped++;
+                continue;
+            }
+            std::this_thread::sleep_until(due);
+        } else if (available() >= hop_bytes) {
+            // the next hop is already waiting, skip this one to catch up
+            stats.dropped++;
+            continue;
+        }
+
+        analyzer.analyze(history.data(), levels.data());
+        const float fall = falloff / fps;
+        for (int b = 0; b < band_count; b++)
+            display[b] = std::max(levels[b], display[b] - fall);
+        render(display.data(), frame);
+
+        // the first frame switches to the custom mode
+        kbd.set_custom_pattern(frame);
+        if (custom_mode) {
+            kbd.write_custom();
+        } else {
+            kbd.write_custom_mode();
+            custom_mode = true;
+        }
+
+        const auto latency = clock::now() - (is_file ? std::max(arrival, due) : arrival);
+        stats.frames++;
+        stats.latency_total += latency;
+        stats.latency_max = std::max(stats.latency_max, latency);
+    }
+
+    stats.elapsed = clock::now() - start;
+    return stats;
+}
@@ -0,0 +1,169 @@
+// audio spectrum shown as bars on the keys
+#ifndef RGB_KEYBOARD_SPECTRUM
+#define RGB_KEYBOARD_SPECTRUM
+
+#include <array>
+#include <chrono>
+#include <complex>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "animation.h"
+#include "key_framebuffer.h"
+#include "key_geometry.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * This class computes the levels of logarithmically spaced frequency bands.
+     *
+     * A block of samples is multiplied with a Hann window and transformed with a real FFT
+     * (a complex radix 2 FFT of half the size). Window, twiddle factors, bit reversal and band
+     * edges are computed by the constructor, analyze() doesn't allocate memory.
+     */
+    class spectrum_analyzer {
+     public:
+        /// Levels below this (in dB relative to a full scale sine) are shown as 0
+        static constexpr float range_db = 60;
+
+        /** Create an analyzer
+         * \param size Number of samples per block, a power of 2 (at least 8)
+         * \param bands Number of frequency bands
+         * \param sample_rate Sample rate in Hz
+         * \param min_frequency, max_frequency Frequency range of the bands, max_frequency is limited to sample_rate / 2
+         * \throws std::invalid_argument if size isn't a power of 2
+         */
+        spectrum_analyzer(int size, int bands, float sample_rate, float min_frequency = 40, float max_frequency = 16000);
+
+        /** Compute the band levels of a block
+         * \param samples size samples between -1 and 1, oldest first
+         * \param levels Receives the level of each band, 0 (range_db below full scale or less) to 1 (full scale)
+         */
+        void analyze(const float* samples, float* levels);
+
+        /// Number of samples per block
+        [[nodiscard]] int size() const { return n; }
+        /// Number of frequency bands
+        [[nodiscard]] int bands() const { return static_cast<int>(band_edges.size()) - 1; }
+
+     private:
+        /// In place complex FFT of buffer, input in bit reversed order
+        void fft();
+
+        /// Block size
+        int n;
+        /// Hann window
+        std::vector<float> window;
+        /// e^(-2πik/n) for k < n/2, the FFT of size n/2 uses every second entry
+        std::vector<std::complex<float>> twiddles;
+        /// Bit reversed index of each entry of buffer
+        std::vector<uint32_t> bit_reverse;
+        /// Even samples in the real part, odd samples in the imaginary part
+        std::vector<std::complex<float>> buffer;
+        /// Band b covers the FFT bins band_edges[b] to band_edges[b + 1] - 1
+        std::vector<int> band_edges;
+        /// Power of a full scale sine after windowing
+        float reference;
+    };
+
+    /**
+     * This class reads 16 bit PCM audio and shows the spectrum as bars in the custom led mode.
+     *
+     * Every hop (sample rate / frame rate samples) the last block of samples is analyzed. The
+     * bands are spread over the key columns from left to right, the bars grow from the bottom
+     * row. Frames are paced by the audio: a pipe is read as fast as the samples arrive, a file
+     * is played in real time. If the keyboard can't keep up, frames are skipped so that the
+     * lights don't fall behind the audio.
+     */
+    class spectrum_visualizer {
+     public:
+        using clock = std::chrono::steady_clock;
+
+        /// Sample format of raw input without a WAV header
+        struct audio_format {
+            int sample_rate = 44100;
+            int channels = 2;
+        };
+
+        /// Timing of play()
+        struct statistics {
+            /// Number of frames sent
+            std::size_t frames = 0;
+            /// Number of hops without a frame because sending took too long
+            std::size_t dropped = 0;
+            /// Time from the first to the last frame
+            clock::duration elapsed{};
+            /// Sum of the times from the arrival of the last sample of a hop to the end of the transfer
+            clock::duration latency_total{};
+            /// Longest of these times
+            clock::duration latency_max{};
+            /// Time the analysis lags behind the newest sample (half a block)
+            clock::duration window_delay{};
+
+            /// Achieved frames per second
+            [[nodiscard]] double fps() const;
+            /// Average audio to light latency in milliseconds, without window_delay
+            [[nodiscard]] double latency_average() const;
+        };
+
+        /** Create a visualizer
+         * \param fd File descriptor the audio is read from, a pipe or a file
+         * \param format Format of raw input, replaced by the format of the WAV header if there is one
+         * \param geometry Key positions of the keyboard
+         * \param palette Colors from the bottom to the top of the bars, empty for green, yellow, red
+         * \param fps Frames per second
+         */
+        spectrum_visualizer(int fd, audio_format format, const key_geometry& geometry, const std::vector<color>& palette, int fps);
+
+        /** Switch the keyboard to the custom led mode and show the spectrum until the input ends
+         * \param kbd The opened keyboard, frames are sent to its current profile
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \throws std::invalid_argument if a WAV header isn't 16 bit PCM
+         */
+        statistics play(keyboard& kbd, const volatile std::sig_atomic_t& stop);
+
+     private:
+        /// Read the WAV header if there is one, the bytes of raw input are kept in pending
+        void read_header(const volatile std::sig_atomic_t& stop);
+        /// Read exactly size bytes, false at the end of the input or if stop is set
+        bool read_bytes(uint8_t* out, std::size_t size, const volatile std::sig_atomic_t& stop);
+        /// Number of bytes that can be read without waiting, 0 for files
+        std::size_t available() const;
+        /// Map the band levels to key colors
+        void render(const float* levels, key_framebuffer& colors);
+
+        int fd;
+        audio_format format;
+        const key_geometry& geometry;
+        int fps;
+        /// True if fd is a regular file, played in real time
+        bool is_file = false;
+
+        /// Bytes read by read_header() that belong to the samples
+        std::vector<uint8_t> pending;
+        /// Samples of one hop, interleaved channels
+        std::vector<int16_t> hop_samples;
+        /// The last block of mono samples, oldest first
+        std::vector<float> history;
+        /// Levels of the current frame
+        std::vector<float> levels;
+        /// Displayed levels, fall slowly
+        std::vector<float> display;
+
+        /// Band of each key index
+        std::array<uint8_t, max_keys> key_band{};
+        /// Level a band needs to light a key
+        std::array<float, max_keys> key_threshold{};
+        /// Color of each key when lit
+        std::array<std::array<uint8_t, max_keys>, 3> key_color{};
+        /// Colors of the current frame
+        alignas(64) std::array<std::array<uint8_t, max_keys>, 3> channels{};
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -0,0 +1,171 @@
+// compile-time lookup tables
+#ifndef RGB_KEYBOARD_STATIC_TABLE
+#define RGB_KEYBOARD_STATIC_TABLE
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace rgb_keyboard {
+
+    /// FNV-1a hash of a name
+    constexpr uint64_t name_hash(std::string_view name) {
+        uint64_t h = 0xcbf29ce484222325;
+        for (char c : name) {
+            h ^= static_cast<uint8_t>(c);
+            h *= 0x100000001b3;
+        }
+        return h;
+    }
+
+    /**
+     * This class is a constant lookup table from names to values, built at compile time.
+     *
+     * The entries are stored sorted by name (this is the order used when iterating).
+     * Names that occur more than once are aliases: the first definition is used,
+     * later ones are ignored, like in a std::map built from the same list.
+     *
+     * Lookups use a minimal perfect hash: each name is hashed into a bucket, each
+     * bucket stores a pilot value that moves all names of the bucket to distinct
+     * free slots. The pilots are searched by the constexpr constructor, a lookup
+     * is two hash calculations and one string comparison.
+     *
+     * \tparam T Type of the values
+     * \tparam N Number of entries, including aliases
+     */
+    template <typename T, std::size_t N>
+    class static_table {
+     public:
+        /// A table entry
+        struct entry {
+            std::string_view first;
+            T second;
+        };
+
+        /// Build the table
+        constexpr static_table(const entry (&entries)[N]) : sorted{}, slots{}, pilots{} {
+            // stable insertion sort by name
+            for (std::size_t i = 0; i < N; i++) {
+                sorted[i] = entries[i];
+                for (std::size_t j = i; j > 0 && sorted[j].first < sorted[j - 1].first; j--) {
+                    entry tmp = sorted[j];
+                    sorted[j] = sorted[j - 1];
+                    sorted[j - 1] = tmp;
+                }
+            }
+
+            // remove aliases, keep the first definition
+            unique = 0;
+            for (std::size_t i = 0; i < N; i++) {
+                if (unique == 0 || sorted[i].first != sorted[unique - 1].first)
+                    sorted[unique++] = sorted[i];
+            }
+            buckets = unique / 2 + 1;
+
+            // number of names in each bucket
+            std::array<std::size_t, N / 2 + 1> bucket_size{};
+            for (std::size_t i = 0; i < unique; i++)
+                bucket_size[bucket_of(hash(sorted[i].first))]++;
+
+            // assign pilots, largest buckets first
+            std::array<bool, N> taken{};
+            for (std::size_t size = N; size > 0; size--) {
+                for (std::size_t bucket = 0; bucket < buckets; bucket++) {
+                    if (bucket_size[bucket] != size)
+                        continue;
+
+                    for (uint64_t pilot = 0;; pilot++) {
+                        // try pilot: all names of the bucket need distinct free slots
+                        std::array<std::size_t, N> chosen{};
+                        std::size_t count = 0;
+                        bool success = true;
+                        for (std::size_t i = 0; i < unique && success; i++) {
+                            uint64_t h = hash(sorted[i].first);
+                            if (bucket_of(h) != bucket)
+                                continue;
+                            std::size_t slot = position(h, pilot);
+                            success = !taken[slot];
+                            for (std::size_t j = 0; j < count && success; j++)
+                                success = slots[chosen[j]] != slot;
+                            chosen[count++] = i;
+                            slots[i] = slot;
+                        }
+
+                        if (success) {
+                            pilots[bucket] = pilot;
+                            for (std::size_t j = 0; j < count; j++)
+                                taken[slots[chosen[j]]] = true;
+                            break;
+                        }
+                    }
+                }
+            }
+
+            // slots held the slot of each entry, store the entry of each slot instead
+            std::array<std::size_t, N> index_of_entry = slots;
+            for (std::size_t i = 0; i < unique; i++)
+                slots[index_of_entry[i]] = i;
+        }
+
+        /// Get the value for a name, nullptr if the name is unknown
+        [[nodiscard]] constexpr const T* find(std::string_view name) const {
+            std::size_t i = index(name);
+            return i < unique ? &sorted[i].second : nullptr;
+        }
+
+        /** Get the position of a name in the sorted entries
+         * \return size() if the name is unknown
+         */
+        [[nodiscard]] constexpr std::size_t index(std::string_view name) const {
+            if (unique == 0)
+                return unique;
+
+            uint64_t h = hash(name);
+            std::size_t i = slots[position(h, pilots[bucket_of(h)])];
+            return sorted[i].first == name ? i : unique;
+        }
+
+        /// Returns true if the name is known
+        [[nodiscard]] constexpr bool contains(std::string_view name) const { return index(name) < unique; }
+
+        /// Number of entries without aliases
+        [[nodiscard]] constexpr std::size_t size() const { return unique; }
+        /// First entry (sorted by name)
+        [[nodiscard]] constexpr const entry* begin() const { return sorted.data(); }
+        /// Past the last entry
+        [[nodiscard]] constexpr const entry* end() const { return sorted.data() + unique; }
+        /// Entry at a position (sorted by name)
+        [[nodiscard]] constexpr const entry& operator[](std::size_t i) const { return sorted[i]; }
+
+        /// Hash of a name, see name_hash()
+        static constexpr uint64_t hash(std::string_view name) { return name_hash(name); }
+
+     private:
+        // hashes are mixed and mapped to a range by multiplying 32 bits with its size, a modulo would be a division on every lookup
+
+        /// Bucket of a name hash, the upper bits of FNV-1a hardly depend on the last characters and are mixed first
+        constexpr std::size_t bucket_of(uint64_t h) const { return (h * 0x9e3779b97f4a7c15 >> 32) * buckets >> 32; }
+
+        /// Slot of a name hash for a pilot value
+        constexpr std::size_t position(uint64_t h, uint64_t pilot) const {
+            uint64_t mixed = h ^ ((pilot + 1) * 0x9e3779b97f4a7c15);
+            mixed ^= mixed >> 29;
+            return (mixed * 0xbf58476d1ce4e5b9 >> 32) * unique >> 32;
+        }
+
+        /// Entries sorted by name, aliases removed
+        std::array<entry, N> sorted;
+        /// Hash slot → index into sorted
+        std::array<std::size_t, N> slots;
+        /// Pilot value of each bucket
+        std::array<uint64_t, N / 2 + 1> pilots;
+        /// Number of entries without aliases
+        std::size_t unique = 0;
+        /// Number of buckets
+        std::size_t buckets = 1;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
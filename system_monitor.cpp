@@ -0,0 +1,242 @@
+#include "system_monitor.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string_view>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "rgb_keyboard.h"
+
+namespace {
+    // the temperature range shown on Esc, in °C
+    constexpr float coldest = 30;
+    constexpr float hottest = 100;
+
+    // start of the line beginning with prefix, nullptr if there is none
+    const char* find_line(std::string_view text, std::string_view prefix) {
+        for (std::size_t position = 0; position < text.size();) {
+            if (text.compare(position, prefix.size(), prefix) == 0)
+                return text.data() + position + prefix.size();
+            position = text.find('\n', position);
+            if (position == std::string_view::npos)
+                break;
+            position++;
+        }
+        return nullptr;
+    }
+
+    // parse an unsigned number after spaces, p is moved behind it
+    uint64_t parse_number(const char*& p) {
+        while (*p == ' ')
+            p++;
+        uint64_t result = 0;
+        for (; *p >= '0' && *p <= '9'; p++)
+            result = result * 10 + (*p - '0');
+        return result;
+    }
+
+    // key indices of the metric keys
+    struct metric_keys {
+        std::array<int, 12> cores;
+        std::array<int, 10> memory;
+        std::array<int, 10> load_average;
+        int temperature;
+    };
+
+    const metric_keys& get_metric_keys() {
+        static const metric_keys keys = [] {
+            using rgb_keyboard::keyboard;
+            metric_keys result;
+            constexpr std::string_view cores[] = {"F1", "F2", "F3", "F4", "F5", "F6", "F7", "F8", "F9", "F10", "F11", "F12"};
+            constexpr std::string_view numbers[] = {"1", "2", "3", "4", "5", "6", "7", "8", "9", "0"};
+            constexpr std::string_view letters[] = {"q", "w", "e", "r", "t", "y", "u", "i", "o", "p"};
+            for (std::size_t i = 0; i < result.cores.size(); i++)
+                result.cores[i] = keyboard::get_led_key_index(cores[i]);
+            for (std::size_t i = 0; i < result.memory.size(); i++) {
+                result.memory[i] = keyboard::get_led_key_index(numbers[i]);
+                result.load_average[i] = keyboard::get_led_key_index(letters[i]);
+            }
+            result.temperature = keyboard::get_led_key_index("Esc");
+            return result;
+        }();
+        return keys;
+    }
+}  // namespace
+
+rgb_keyboard::system_monitor::system_monitor(const std::vector<color>& palette, int levels) : levels(std::clamp(levels, 2, 256)) {
+    this->palette = animation::make_palette(palette.empty() ? std::vector<color>{{0x00, 0xff, 0x00}, {0xff, 0xff, 0x00}, {0xff, 0x00, 0x00}} : palette);
+
+    stat_fd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    meminfo_fd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    loadavg_fd = open("/proc/loadavg", O_RDONLY | O_CLOEXEC);
+
+    // zones are numbered without gaps
+    thermal_fds.fill(-1);
+    for (int zone = 0; zone < max_thermal_zones; zone++) {
+        char path[64];
+        std::snprintf(path, sizeof(path), "/sys/class/thermal/thermal_zone%d/temp", zone);
+        int fd = open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            break;
+        thermal_fds[thermal_count++] = fd;
+    }
+}
+
+rgb_keyboard::system_monitor::~system_monitor() {
+    for (int fd : {stat_fd, meminfo_fd, loadavg_fd}) {
+        if (fd >= 0)
+            close(fd);
+    }
+    for (int zone = 0; zone < thermal_count; zone++)
+        close(thermal_fds[zone]);
+}
+
+std::size_t rgb_keyboard::system_monitor::read_file(int fd) {
+    if (fd < 0)
+        return 0;
+    const ssize_t length = pread(fd, buffer.data(), buffer.size() - 1, 0);
+    if (length <= 0)
+        return 0;
+    buffer[length] = '\0';
+    return length;
+}
+
+const rgb_keyboard::system_monitor::sample& rgb_keyboard::system_monitor::read() {
+    // cpu lines: cpuN user nice system idle iowait irq softirq steal, guest time is included in user
+    if (std::size_t length = read_file(stat_fd); length != 0) {
+        const std::string_view text(buffer.data(), length);
+        int cpu_count = 0;
+        // line points behind "cpu" of a core line
+        const char* line = find_line(text, "cpu0");
+        if (line != nullptr)
+            line--;
+        while (line != nullptr && cpu_count < max_cpus) {
+            const char* p = line;
+            while (*p >= '0' && *p <= '9')
+                p++;
+            uint64_t fields[8];
+            for (auto& field : fields)
+                field = parse_number(p);
+
+            uint64_t total = 0;
+            for (auto field : fields)
+                total += field;
+            const uint64_t busy = total - fields[3] - fields[4];
+            const uint64_t total_delta = total - previous_total[cpu_count];
+            current.cpu_load[cpu_count] = total_delta != 0 ? static_cast<float>(busy - previous_busy[cpu_count]) / total_delta : 0;
+            previous_busy[cpu_count] = busy;
+            previous_total[cpu_count] = total;
+            cpu_count++;
+
+            // the next line is the next core, if it is a cpu line
+            const char* next = std::find(p, text.data() + text.size(), '\n');
+            line = text.data() + text.size() - next > 4 && std::string_view(next + 1, 3) == "cpu" ? next + 4 : nullptr;
+        }
+        current.cpu_count = cpu_count;
+    }
+
+    if (std::size_t length = read_file(meminfo_fd); length != 0) {
+        const std::string_view text(buffer.data(), length);
+        const char* total_line = find_line(text, "MemTotal:");
+        const char* available_line = find_line(text, "MemAvailable:");
+        if (total_line != nullptr && available_line != nullptr) {
+            const uint64_t total = parse_number(total_line);
+            const uint64_t available = parse_number(available_line);
+            current.memory = total != 0 ? 1 - static_cast<float>(available) / total : 0;
+        }
+    }
+
+    if (read_file(loadavg_fd) != 0)
+        current.load_average = std::strtof(buffer.data(), nullptr) / std::max(current.cpu_count, 1);
+
+    // millidegrees, zones may be negative or fail to read
+    current.temperature = 0;
+    for (int zone = 0; zone < thermal_count; zone++) {
+        if (read_file(thermal_fds[zone]) != 0)
+            current.temperature = std::max(current.temperature, std::strtol(buffer.data(), nullptr, 10) / 1000.0f);
+    }
+
+    return current;
+}
+
+rgb_keyboard::color rgb_keyboard::system_monitor::quantize(float value) const {
+    const int level = std::clamp(static_cast<int>(value * (levels - 1) + 0.5f), 0, levels - 1);
+    const int index = level * 255 / (levels - 1);
+    return {palette[0][index], palette[1][index], palette[2][index]};
+}
+
+void rgb_keyboard::system_monitor::render(key_framebuffer& colors) const {
+    const metric_keys& keys = get_metric_keys();
+
+    // one key per core, cores are spread evenly when there are more cores than keys
+    const int core_keys = std::min<int>(current.cpu_count, keys.cores.size());
+    for (int i = 0; i < core_keys; i++) {
+        const int first = i * current.cpu_count / core_keys;
+        const int last = (i + 1) * current.cpu_count / core_keys;
+        float load = 0;
+        for (int cpu = first; cpu < last; cpu++)
+            load += current.cpu_load[cpu];
+        colors.set(keys.cores[i], quantize(load / (last - first)));
+    }
+
+    // bars, the color of a key is its position in the bar
+    auto bar = [&](const std::array<int, 10>& bar_keys, float value) {
+        const int lit = std::clamp(static_cast<int>(value * bar_keys.size() + 0.5f), 0, static_cast<int>(bar_keys.size()));
+        for (int i = 0; i < static_cast<int>(bar_keys.size()); i++)
+            colors.set(bar_keys[i], i < lit ? quantize(static_cast<float>(i) / (bar_keys.size() - 1)) : color{0x00, 0x00, 0x00});
+    };
+    bar(keys.memory, current.memory);
+    bar(keys.load_average, current.load_average);
+
+    if (thermal_count != 0)
+        colors.set(keys.temperature, quantize((current.temperature - coldest) / (hottest - coldest)));
+}
+
+rgb_keyboard::system_monitor::statistics rgb_keyboard::system_monitor::play(keyboard& kbd, std::chrono::milliseconds interval,
+                                                                            const volatile std::sig_atomic_t& stop) {
+    statistics stats;
+    key_framebuffer frame;
+    key_framebuffer shown;
+
+    // first sample, then switch to the custom mode
+    read();
+    render(frame);
+    kbd.set_custom_pattern(frame);
+    kbd.write_custom_mode();
+    shown = frame;
+
+    // the timer wakes up once per interval, poll() returns early for signals
+    int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (timer < 0)
+        return stats;
+    const timespec period{static_cast<time_t>(interval.count() / 1000), static_cast<long>(interval.count() % 1000 * 1000000)};
+    const itimerspec schedule{period, period};
+    timerfd_settime(timer, 0, &schedule, nullptr);
+
+    while (!stop) {
+        pollfd timer_poll{timer, POLLIN, 0};
+        uint64_t expirations;
+        if (poll(&timer_poll, 1, -1) <= 0 || ::read(timer, &expirations, sizeof(expirations)) != sizeof(expirations))
+            continue;
+
+        read();
+        render(frame);
+        stats.samples++;
+
+        // nothing is sent when no quantized color changed
+        if (frame == shown)
+            continue;
+        shown = frame;
+        kbd.set_custom_pattern(frame);
+        kbd.write_custom();
+        stats.uploads++;
+    }
+
+    close(timer);
+    return stats;
+}
@@ -0,0 +1,119 @@
+// system load, memory and temperature shown on the keys
+#ifndef RGB_KEYBOARD_SYSTEM_MONITOR
+#define RGB_KEYBOARD_SYSTEM_MONITOR
+
+#include <array>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "animation.h"
+#include "key_framebuffer.h"
+
+namespace rgb_keyboard {
+
+    class keyboard;
+
+    /**
+     * This class samples system metrics and shows them in the custom led mode.
+     *
+     * - F1 - F12: load of the cpu cores, one key per core (several cores per key on larger machines)
+     * - 1 - 0: memory use as a bar
+     * - q - p: 1 minute load average per core as a bar
+     * - Esc: hottest thermal zone, 30 - 100 °C
+     *
+     * /proc/stat, /proc/meminfo, /proc/loadavg and the thermal zones are opened once and read with
+     * pread() into a fixed buffer, parsing doesn't allocate. Colors are quantized to a few levels,
+     * a sample that doesn't change a color isn't sent to the keyboard at all. The sampling loop
+     * sleeps on a timerfd and wakes up once per interval.
+     */
+    class system_monitor {
+     public:
+        /// Maximum number of cpu cores sampled
+        static constexpr int max_cpus = 256;
+        /// Maximum number of thermal zones sampled
+        static constexpr int max_thermal_zones = 16;
+
+        /// Metrics of a sample
+        struct sample {
+            /// Number of cpu cores
+            int cpu_count = 0;
+            /// Load of each core since the previous sample, 0 - 1
+            std::array<float, max_cpus> cpu_load{};
+            /// Used memory (total - available), 0 - 1
+            float memory = 0;
+            /// 1 minute load average divided by the number of cores
+            float load_average = 0;
+            /// Temperature of the hottest thermal zone in °C, 0 if there is none
+            float temperature = 0;
+        };
+
+        /// Counters of play()
+        struct statistics {
+            /// Samples taken
+            std::size_t samples = 0;
+            /// Samples with a changed color, i.e. write_custom() calls
+            std::size_t uploads = 0;
+        };
+
+        /** Open the metric files
+         * \param palette Colors from low to high (evenly spaced), empty for green - yellow - red
+         * \param levels Number of colors a metric is quantized to, 2 - 256
+         */
+        explicit system_monitor(const std::vector<color>& palette = {}, int levels = 8);
+        ~system_monitor();
+        system_monitor(const system_monitor&) = delete;
+        system_monitor& operator=(const system_monitor&) = delete;
+
+        /** Read all metrics
+         * The cpu load of the first sample is the load since boot.
+         * \return The sample, valid until the next call
+         */
+        const sample& read();
+
+        /** Render the last sample
+         * \param colors Receives the colors of the metric keys
+         */
+        void render(key_framebuffer& colors) const;
+
+        /** Switch the keyboard to the custom led mode and show the metrics
+         * \param kbd The opened keyboard, the metrics are sent to its current profile
+         * \param interval Time between samples
+         * \param stop Stop when this is set (e.g. from a signal handler)
+         * \return Counters
+         */
+        statistics play(keyboard& kbd, std::chrono::milliseconds interval, const volatile std::sig_atomic_t& stop);
+
+     private:
+        /** Read a file from the start into the buffer
+         * \return Number of bytes read, 0 on errors
+         */
+        std::size_t read_file(int fd);
+        /// Color of a value between 0 and 1
+        [[nodiscard]] color quantize(float value) const;
+
+        /// Palette lookup tables
+        animation::palette_table palette;
+        /// Number of colors
+        int levels;
+
+        int stat_fd = -1;
+        int meminfo_fd = -1;
+        int loadavg_fd = -1;
+        std::array<int, max_thermal_zones> thermal_fds;
+        int thermal_count = 0;
+
+        /// Busy and total cpu time of each core at the previous sample
+        std::array<uint64_t, max_cpus> previous_busy{};
+        std::array<uint64_t, max_cpus> previous_total{};
+
+        sample current;
+        /// Read buffer, large enough for /proc/stat of max_cpus cores
+        std::array<char, 65536> buffer;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
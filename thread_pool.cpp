@@ -0,0 +1,112 @@
+#include "thread_pool.h"
+
+#include <algorithm>
+
+rgb_keyboard::thread_pool::thread_pool(unsigned int threads) {
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+
+    queues = std::make_unique<work_queue[]>(threads);
+    for (unsigned int i = 0; i < threads; i++)
+        workers.emplace_back(&thread_pool::run, this, i);
+}
+
+rgb_keyboard::thread_pool::~thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    start.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void rgb_keyboard::thread_pool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& function) {
+    if (count == 0)
+        return;
+
+    // one contiguous block of indices per worker, nothing is running yet
+    for (std::size_t i = 0; i < workers.size(); i++) {
+        std::lock_guard<std::mutex> lock(queues[i].mutex);
+        for (std::size_t index = count * i / workers.size(); index < count * (i + 1) / workers.size(); index++)
+            queues[i].indices.push_back(index);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job = &function;
+    remaining = count;
+    error = nullptr;
+    generation++;
+    start.notify_all();
+
+    // wait until no worker can take an index of this loop anymore
+    done.wait(lock, [this] { return remaining == 0 && active == 0; });
+    job = nullptr;
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+bool rgb_keyboard::thread_pool::take(std::size_t self, std::size_t& index) {
+    // own queue: newest index first
+    {
+        std::lock_guard<std::mutex> lock(queues[self].mutex);
+        if (!queues[self].indices.empty()) {
+            index = queues[self].indices.back();
+            queues[self].indices.pop_back();
+            return true;
+        }
+    }
+
+    // steal the oldest index of another worker
+    for (std::size_t i = 1; i < workers.size(); i++) {
+        work_queue& victim = queues[(self + i) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.indices.empty()) {
+            index = victim.indices.front();
+            victim.indices.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void rgb_keyboard::thread_pool::run(std::size_t self) {
+    std::size_t seen = 0;
+
+    while (true) {
+        const std::function<void(std::size_t)>* function;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start.wait(lock, [&] { return stop || generation != seen; });
+            if (stop)
+                return;
+            seen = generation;
+            // the loop may already have finished
+            function = job;
+            if (function == nullptr)
+                continue;
+            active++;
+        }
+
+        // all indices are queued before the loop starts, no new work appears until it has finished
+        std::size_t index;
+        while (take(self, index)) {
+            try {
+                (*function)(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error)
+                    error = std::current_exception();
+            }
+            remaining--;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        active--;
+        if (active == 0 && remaining == 0)
+            done.notify_one();
+    }
+}
@@ -0,0 +1,79 @@
+// work-stealing thread pool
+#ifndef RGB_KEYBOARD_THREAD_POOL
+#define RGB_KEYBOARD_THREAD_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rgb_keyboard {
+
+    /**
+     * A fixed number of worker threads that run parallel loops.
+     *
+     * Each worker has its own queue of loop indices, initially a contiguous block. A worker takes
+     * indices from the back of its own queue and, once it is empty, steals from the front of the
+     * other queues, so uneven work (e.g. files of very different size) is balanced.
+     */
+    class thread_pool {
+     public:
+        /// Start the workers, 0 uses one worker per cpu core
+        explicit thread_pool(unsigned int threads = 0);
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /** Call function(i) for all i in [0, count) on the workers, returns when all calls have finished
+         * \throws The first exception thrown by function, after all other calls have finished
+         */
+        void parallel_for(std::size_t count, const std::function<void(std::size_t)>& function);
+
+        /// Number of worker threads
+        [[nodiscard]] std::size_t size() const { return workers.size(); }
+
+     private:
+        /// Queue of loop indices of a worker
+        struct work_queue {
+            std::mutex mutex;
+            std::deque<std::size_t> indices;
+        };
+
+        /// Main function of the worker threads
+        void run(std::size_t self);
+        /// Take an index from the own queue or steal one, false if all queues are empty
+        bool take(std::size_t self, std::size_t& index);
+
+        std::vector<std::thread> workers;
+        std::unique_ptr<work_queue[]> queues;
+
+        /// Protects everything below
+        std::mutex mutex;
+        /// Signals a new loop or stop to the workers
+        std::condition_variable start;
+        /// Signals the end of a loop to parallel_for()
+        std::condition_variable done;
+        /// Function of the current loop
+        const std::function<void(std::size_t)>* job = nullptr;
+        /// Incremented for each loop
+        std::size_t generation = 0;
+        /// Number of workers taking indices of the current loop
+        std::size_t active = 0;
+        /// Number of unfinished calls of the current loop, only decremented without the lock
+        std::atomic<std::size_t> remaining = 0;
+        /// First exception of the current loop
+        std::exception_ptr error;
+        /// Set by the destructor
+        bool stop = false;
+    };
+
+}  // namespace rgb_keyboard
+
+#endif
@@ -1,5 +1,7 @@
 #include "rgb_keyboard.h"
 
+#include "keymap_parser.h"
+
 // writer functions (apply changes to keyboard)
 
 int rgb_keyboard::keyboard::write_brightness() {
@@ -8,7 +10,7 @@ int rgb_keyboard::keyboard::write_brightness() {
 
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
 
     if (profile == 1) {
         data_settings[1] = 0x08 + brightness[profile - 1];
@@ -40,7 +42,7 @@ int rgb_keyboard::keyboard::write_speed() {
 
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
 
     if (profile == 1) {
         data_settings[1] = 0x0d - speed[profile - 1];
@@ -72,7 +74,7 @@ int rgb_keyboard::keyboard::write_direction() {
 
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
 
     if (profile == 1) {
         switch (direction[profile - 1]) {
@@ -138,9 +140,12 @@ int rgb_keyboard::keyboard::write_mode() {
     // vars
     int res = 0;
 
+    // the keyboard may not keep the custom colors when changing the mode
+    key_colors_shadow_valid[profile - 1] = false;
+
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
 
     if (profile == 1) {
         switch (mode[profile - 1]) {
@@ -459,6 +464,9 @@ int rgb_keyboard::keyboard::write_color() {
     uint8_t data_settings_2[64];
     std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings_2));
 
+    // calibrated color
+    const color calibrated = calibration.apply(color{color_r[profile - 1], color_g[profile - 1], color_b[profile - 1]});
+
     if (profile == 1) {
         data_settings_1[1] = 0x0b;
         data_settings_1[5] = 0x04;
@@ -470,9 +478,9 @@ int rgb_keyboard::keyboard::write_color() {
         data_settings_2[2] = 0x02;
         data_settings_2[4] = 0x03;
         data_settings_2[5] = 0x05;
-        data_settings_2[8] = color_r[profile - 1];
-        data_settings_2[9] = color_g[profile - 1];
-        data_settings_2[10] = color_b[profile - 1];
+        data_settings_2[8] = calibrated[0];
+        data_settings_2[9] = calibrated[1];
+        data_settings_2[10] = calibrated[2];
     } else if (profile == 2) {
         data_settings_1[1] = 0x35;
         data_settings_1[5] = 0x2e;
@@ -484,9 +492,9 @@ int rgb_keyboard::keyboard::write_color() {
 
         data_settings_2[4] = 0x03;
         data_settings_2[5] = 0x2f;
-        data_settings_2[8] = color_r[profile - 1];
-        data_settings_2[9] = color_g[profile - 1];
-        data_settings_2[10] = color_b[profile - 1];
+        data_settings_2[8] = calibrated[0];
+        data_settings_2[9] = calibrated[1];
+        data_settings_2[10] = calibrated[2];
     } else if (profile == 3) {
         data_settings_1[1] = 0x5f;
         data_settings_1[5] = 0x58;
@@ -498,9 +506,9 @@ int rgb_keyboard::keyboard::write_color() {
 
         data_settings_2[4] = 0x03;
         data_settings_2[5] = 0x59;
-        data_settings_2[8] = color_r[profile - 1];
-        data_settings_2[9] = color_g[profile - 1];
-        data_settings_2[10] = color_b[profile - 1];
+        data_settings_2[8] = calibrated[0];
+        data_settings_2[9] = calibrated[1];
+        data_settings_2[10] = calibrated[2];
     } else {
         throw std::invalid_argument("Invalid profile number");
     }
@@ -521,60 +529,75 @@ int rgb_keyboard::keyboard::write_custom() {
 
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
     data_settings[2] = 0x02;
     data_settings[3] = 0x11;
     data_settings[4] = 0x03;
 
+    // custom pattern with the layers and the visible overlays on top
+    const key_framebuffer& pattern = layers[profile - 1].empty() ? key_colors[profile - 1] : layers[profile - 1].compose(key_colors[profile - 1]);
+    overlays[profile - 1].expire();
+    const key_framebuffer shown = overlays[profile - 1].compose(pattern);
+
+    // only send keys that differ from the colors the keyboard displays
+    key_framebuffer changed = shown;
+    if (key_colors_shadow_valid[profile - 1])
+        changed = shown.difference(key_colors_shadow[profile - 1]);
+    else
+        key_colors_shadow[profile - 1].clear();
+
+    if (changed.count() == 0) {
+        overlays[profile - 1].restored();
+        return 0;
+    }
+
+    // convert calibrated colors to packet format
+    alignas(64) uint8_t colors[max_keys * 3];
+    calibration.apply(shown).interleave(colors);
+
+    // profile 2 and 3 are stored at higher addresses
+    uint8_t profile_offset = 0x02 * (profile - 1);
+
     // write start data
     res += write_data(data_start, 64);
 
-    // process loaded config and send data
-    for (std::pair<std::string, std::array<uint8_t, 3>> element : key_colors[profile - 1]) {
-        if (keycodes.find(element.first) != keycodes.end()) {
-            // if keycode is stored in _keycodes: set values in data packets
-
-            // prepare data packet
-            if (profile == 1) {
-                // keycode
-                data_settings[1] = keycodes.at(element.first)[0];
-                data_settings[5] = keycodes.at(element.first)[1];
-                data_settings[6] = keycodes.at(element.first)[2];
-
-                // color
-                data_settings[8] = element.second[0];
-                data_settings[9] = element.second[1];
-                data_settings[10] = element.second[2];
-            } else if (profile == 2) {
-                // keycode
-                data_settings[1] = keycodes.at(element.first)[0] + 0x02;
-                data_settings[5] = keycodes.at(element.first)[1];
-                data_settings[6] = keycodes.at(element.first)[2] + 0x02;
-
-                // color
-                data_settings[8] = element.second[0];
-                data_settings[9] = element.second[1];
-                data_settings[10] = element.second[2];
-            } else if (profile == 3) {
-                // keycode
-                data_settings[1] = keycodes.at(element.first)[0] + 0x04;
-                data_settings[5] = keycodes.at(element.first)[1];
-                data_settings[6] = keycodes.at(element.first)[2] + 0x04;
-
-                // color
-                data_settings[8] = element.second[0];
-                data_settings[9] = element.second[1];
-                data_settings[10] = element.second[2];
-            }
+    // send data for each key with a color
+    changed.for_each([&](int key) {
+        // keycode
+        uint16_t address = key * 3;
+        data_settings[1] = model->led_checksums[key] + profile_offset;
+        data_settings[5] = address & 0xff;
+        data_settings[6] = (address >> 8) + profile_offset;
 
-            // send data
-            res += write_data(data_settings, 64);
-        }
-    }
+        // color
+        std::copy_n(colors + address, 3, data_settings + 8);
+
+        // send data
+        res += write_data(data_settings, 64);
+    });
 
     // write end data
     res += write_data(data_end, 64);
 
+    // the keyboard state is unknown if a transfer failed
+    key_colors_shadow[profile - 1].merge(changed);
+    key_colors_shadow_valid[profile - 1] = (res == 0);
+    if (res == 0)
+        overlays[profile - 1].restored();
+
+    return res;
+}
+
+// writes custom pattern to keyboard and switches to the custom mode
+int rgb_keyboard::keyboard::write_custom_mode() {
+    int res = write_custom();
+    set_mode(modes::custom);
+    res += write_mode();
+
+    // the keyboard keeps the colors, write_mode() forgot them
+    if (res == 0)
+        assume_custom_written();
+
     return res;
 }
 
@@ -584,7 +607,7 @@ int rgb_keyboard::keyboard::write_variant() {
 
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
     data_settings[5] = 0x08;
 
     // convert variant
@@ -662,7 +685,7 @@ int rgb_keyboard::keyboard::write_report_rate() {
 
     // prepare data packet
     uint8_t data_settings[64];
-    std::copy(std::begin(data_settings), std::end(data_settings), std::begin(data_settings));
+    std::copy(std::begin(keyboard::data_settings), std::end(keyboard::data_settings), std::begin(data_settings));
     data_settings[5] = 0x0f;
 
     // convert report rate
@@ -735,9 +758,9 @@ int rgb_keyboard::keyboard::write_report_rate() {
 }
 
 int rgb_keyboard::keyboard::write_key_mapping_ansi() {
-    // sanity check, this function does not support the Ajazz AK33
-    if (ajazzak33Compatibility)
-        throw std::invalid_argument("Not supported on the Ajazz AK33");
+    // sanity check, this function only supports the ANSI layout
+    if (model->keymap_offsets == nullptr)
+        throw std::invalid_argument(std::string("Not supported on the ") + model->name);
 
     // vars
     int res = 0;
@@ -769,22 +792,22 @@ int rgb_keyboard::keyboard::write_key_mapping_ansi() {
 
     // change data to include keycodes at the right positions
     for (const auto& element : keymap[profile - 1]) {
+        const auto* offsets = model->keymap_offsets->find(element.first);
+        const auto* option = keymap_options.find(element.second);
+
         // is key name and key function known?
-        if (keymap_offsets.find(element.first) != keymap_offsets.end() && keymap_options.find(element.second) != keymap_options.end()) {
-            data_remap[keymap_offsets.at(element.first)[0][0]][keymap_offsets.at(element.first)[0][1]] = keymap_options.at(element.second)[0];
-            data_remap[keymap_offsets.at(element.first)[1][0]][keymap_offsets.at(element.first)[1][1]] = keymap_options.at(element.second)[1];
-            data_remap[keymap_offsets.at(element.first)[2][0]][keymap_offsets.at(element.first)[2][1]] = keymap_options.at(element.second)[2];
+        if (offsets != nullptr && option != nullptr) {
+            data_remap[(*offsets)[0][0]][(*offsets)[0][1]] = (*option)[0];
+            data_remap[(*offsets)[1][0]][(*offsets)[1][1]] = (*option)[1];
+            data_remap[(*offsets)[2][0]][(*offsets)[2][1]] = (*option)[2];
 
             // is key name known and function is a macro?
-        } else if (keymap_offsets.find(element.first) != keymap_offsets.end() && std::regex_match(element.second, std::regex("macro[0-9]+"))) {
-            std::string macroname = element.second;
-            int macronumber = std::stoi(macroname.erase(0, 5));
-
+        } else if (int macronumber = macro_number(element.second); offsets != nullptr && macronumber >= 0) {
             // check for range of macronumber
-            if (macronumber <= 100 && macronumber >= 1) {
-                data_remap[keymap_offsets.at(element.first)[0][0]][keymap_offsets.at(element.first)[0][1]] = 0x05;
-                data_remap[keymap_offsets.at(element.first)[1][0]][keymap_offsets.at(element.first)[1][1]] = 0x01;
-                data_remap[keymap_offsets.at(element.first)[2][0]][keymap_offsets.at(element.first)[2][1]] = macronumber - 1;
+            if (macronumber <= max_macros && macronumber >= 1) {
+                data_remap[(*offsets)[0][0]][(*offsets)[0][1]] = 0x05;
+                data_remap[(*offsets)[1][0]][(*offsets)[1][1]] = 0x01;
+                data_remap[(*offsets)[2][0]][(*offsets)[2][1]] = macronumber - 1;
             }
         }
     }
@@ -867,7 +890,7 @@ int rgb_keyboard::keyboard::write_active_profile() {
 
     // prepare data packets
     uint8_t data_profile[64];
-    std::copy(std::begin(data_profile), std::end(data_profile), std::begin(data_profile));
+    std::copy(std::begin(keyboard::data_profile), std::end(keyboard::data_profile), std::begin(data_profile));
 
     // change data
     if (active_profile == 1) {
@@ -888,5 +911,27 @@ int rgb_keyboard::keyboard::write_active_profile() {
     // write data
     res += write_data(data_profile, 64);
 
+    // the custom colors of the newly active profile are not known
+    invalidate_custom();
+
+    return res;
+}
+
+int rgb_keyboard::keyboard::write_program(const packet_program& program) {
+    // sanity check, the transfer method depends on the model
+    if (program.get_model() != model->program_model)
+        throw std::invalid_argument("Packet program was compiled for a different keyboard model");
+
+    // vars
+    int res = 0;
+
+    // send all packets unmodified
+    const packet* packets = program.data();
+    for (std::size_t i = 0; i < program.size(); i++)
+        res += write_data(packets[i].data(), packet_length);
+
+    // the program may have changed the custom colors
+    invalidate_custom();
+
     return res;
 }